@@ -0,0 +1,478 @@
+// Benchmark and bit-exactness check for the CPU bitpacking kernels.
+// Every kernel the CPU supports is run on random phase data and compared byte for byte
+// against the reference scalar kernel (which ORs into a zeroed frame). The pixel-major
+// kernels get a frame full of garbage, since they have to write every texel themselves.
+// The full-size frame is then packed on the thread pool with 1, 2, 4, ... threads, and
+// once more with a non-monotonic lookup-table, which only the scalar path handles.
+// The level kernels are checked on the quantised levels of the same phases, and the
+// uint8/uint16 phase kernels on random fixed-point values against their float equivalents.
+// Double phases are checked in row-major, column-major and padded layouts, float ones in
+// column-major, interleaved and reversed-row views.
+// Last, a batch with a partial final frame is packed straight into the frame store and
+// checked frame by frame, and timed against packing and inserting one frame per call.
+// A single frame is packed as RGB into a slot by every kernel, and BitpackAndInsert timed
+// against BitpackHolograms + Insert.
+// Then one hologram of a stored frame is replaced in place and compared with a full repack.
+// Finally RGB and RGBA frames are inserted into the store on one thread and on the pool,
+// and checked (and read back) against byte-by-byte conversions.
+//
+// Build (from the repository root):
+//   g++ -O3 -std=c++17 -Icore bench/bench_bitpack.cpp core/bitpack.cpp core/quantiser.cpp core/thread_pool.cpp core/frame_store.cpp core/sequencer.cpp core/plm_core.cpp -pthread -o bench_bitpack
+
+#include "bitpack.h"
+#include "quantiser.h"
+#include "plm_core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const float ti_phases[QUANTISER_LUT_SIZE] = { 0, 0.0100, 0.0205, 0.0422, 0.0560, 0.0727, 0.1131, 0.1734, 0.3426, 0.3707, 0.4228, 0.4916, 0.5994, 0.6671, 0.7970, 0.9375, 1.0 };
+static const float shuffled_phases[QUANTISER_LUT_SIZE] = { 0, 0.0205, 0.0100, 0.0422, 0.0727, 0.0560, 0.1131, 0.3426, 0.1734, 0.3707, 0.4916, 0.4228, 0.5994, 0.7970, 0.6671, 0.9375, 1.0 };
+
+struct Case {
+	uint64_t N, M;
+	int num_holograms;
+	int repeats;
+};
+
+static void RandomPhase(std::mt19937& rng, const PhaseQuantiser& quantiser, std::vector<float>& phase) {
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	std::uniform_int_distribution<int> pick(0, 63);
+	const float* t = quantiser.Thresholds();
+	for (auto& v : phase) {
+		int p = pick(rng);
+		// Sprinkle exact decision thresholds and out of range values among the uniform ones
+		if (p == 0) v = t[pick(rng) % QUANTISER_LEVELS];
+		else if (p == 1) v = std::nextafter(t[pick(rng) % QUANTISER_LEVELS], -1.0f);
+		else if (p == 2) v = (pick(rng) % 2) ? 1.0f : -0.25f;
+		else v = uniform(rng);
+	};
+}
+
+int main() {
+
+	PhaseQuantiser quantiser(ti_phases);
+	std::mt19937 rng(42);
+
+	const BitpackISA best = DetectBitpackISA();
+	printf("Detected ISA: %s\n", BitpackISAName(best));
+
+	const Case cases[] = {
+		{ 1358, 800, 24, 3 },
+		{ 1358, 800, 17, 1 },
+		{ 37, 5, 24, 1 },
+		{ 3, 2, 1, 1 },
+		{ 64, 64, 24, 1 },
+	};
+
+	using clock = std::chrono::high_resolution_clock;
+	int failures = 0;
+
+	for (const Case& c : cases) {
+		std::vector<float> phase(c.N * c.M * c.num_holograms);
+		RandomPhase(rng, quantiser, phase);
+
+		int phase_map[64];
+		std::uniform_int_distribution<int> bit(0, 1);
+		for (int& b : phase_map) b = bit(rng);
+
+		const uint64_t frame_bytes = 4 * (2 * c.N) * (2 * c.M);
+		std::vector<uint8_t> reference(frame_bytes, 0);
+
+		auto t0 = clock::now();
+		for (int r = 0; r < c.repeats; r++) {
+			std::fill(reference.begin(), reference.end(), 0);
+			BitpackHologramsScalar(phase.data(), reference.data(), c.N, c.M, c.num_holograms, quantiser, phase_map, 0, c.M);
+		};
+		std::chrono::duration<double> scalar = (clock::now() - t0) / c.repeats;
+
+		printf("%llu x %llu x %d\n", (unsigned long long)c.N, (unsigned long long)c.M, c.num_holograms);
+		printf("  %-7s %9.3f ms (reference)\n", BitpackISAName(BITPACK_ISA_SCALAR), scalar.count() * 1000);
+
+		for (int isa = BITPACK_ISA_SCALAR; isa <= best; isa++) {
+			// Garbage in the output, the pixel-major kernels must overwrite all of it
+			std::vector<uint8_t> frame(frame_bytes, 0xA5);
+
+			auto t1 = clock::now();
+			for (int r = 0; r < c.repeats; r++) {
+				BitpackHologramRows(phase.data(), frame.data(), c.N, c.M, c.num_holograms, quantiser, phase_map, 0, c.M, (BitpackISA)isa);
+			};
+			std::chrono::duration<double> simd = (clock::now() - t1) / c.repeats;
+
+			bool exact = std::memcmp(frame.data(), reference.data(), frame_bytes) == 0;
+			failures += !exact;
+			printf("  %-7s %9.3f ms, %.1fx, %s\n", BitpackISAName((BitpackISA)isa), simd.count() * 1000,
+				scalar.count() / simd.count(), exact ? "bit-exact" : "MISMATCH");
+		};
+
+		// The same holograms as pre-quantised levels, one per byte and nibble-packed
+		std::vector<uint8_t> levels(phase.size());
+		std::vector<uint8_t> nibbles(LevelBytes(LEVEL_FORMAT_NIBBLE, phase.size()), 0);
+		for (size_t e = 0; e < phase.size(); e++) {
+			levels[e] = (uint8_t)quantiser(phase[e]);
+			nibbles[e / 2] |= levels[e] << (4 * (e & 1));
+		};
+
+		for (int format = LEVEL_FORMAT_U8; format <= LEVEL_FORMAT_NIBBLE; format++) {
+			const uint8_t* input = format == LEVEL_FORMAT_U8 ? levels.data() : nibbles.data();
+			for (int isa = BITPACK_ISA_SCALAR; isa <= best; isa++) {
+				std::vector<uint8_t> frame(frame_bytes, 0xA5);
+
+				auto t1 = clock::now();
+				for (int r = 0; r < c.repeats; r++) {
+					BitpackLevelRows(input, (LevelFormat)format, frame.data(), c.N, c.M, c.num_holograms, phase_map, 0, c.M, (BitpackISA)isa);
+				};
+				std::chrono::duration<double> packed = (clock::now() - t1) / c.repeats;
+
+				bool exact = std::memcmp(frame.data(), reference.data(), frame_bytes) == 0;
+				failures += !exact;
+				printf("  %-7s %9.3f ms, %.1fx, %s (%s levels)\n", BitpackISAName((BitpackISA)isa), packed.count() * 1000,
+					scalar.count() / packed.count(), exact ? "bit-exact" : "MISMATCH", format == LEVEL_FORMAT_U8 ? "u8" : "nibble");
+			};
+		};
+
+		// Fixed-point phases against the float reference of v / 255 and v / 65535
+		std::vector<uint8_t> phase_u8(phase.size());
+		std::vector<uint16_t> phase_u16(phase.size());
+		std::vector<float> as_float(phase.size());
+		std::vector<uint8_t> fixed_reference(frame_bytes);
+		for (int bits = 8; bits <= 16; bits += 8) {
+			const uint32_t max = bits == 8 ? 255 : 65535;
+			std::uniform_int_distribution<uint32_t> value(0, max);
+			for (size_t e = 0; e < phase.size(); e++) {
+				uint32_t v = value(rng);
+				phase_u8[e] = (uint8_t)v;
+				phase_u16[e] = (uint16_t)v;
+				as_float[e] = (float)v / (float)max;
+			};
+			std::fill(fixed_reference.begin(), fixed_reference.end(), 0);
+			BitpackHologramsScalar(as_float.data(), fixed_reference.data(), c.N, c.M, c.num_holograms, quantiser, phase_map, 0, c.M);
+
+			for (int isa = BITPACK_ISA_SCALAR; isa <= best; isa++) {
+				std::vector<uint8_t> frame(frame_bytes, 0xA5);
+
+				auto t1 = clock::now();
+				for (int r = 0; r < c.repeats; r++) {
+					if (bits == 8) BitpackHologramRows(phase_u8.data(), frame.data(), c.N, c.M, c.num_holograms, quantiser, phase_map, 0, c.M, (BitpackISA)isa);
+					else BitpackHologramRows(phase_u16.data(), frame.data(), c.N, c.M, c.num_holograms, quantiser, phase_map, 0, c.M, (BitpackISA)isa);
+				};
+				std::chrono::duration<double> packed = (clock::now() - t1) / c.repeats;
+
+				bool exact = std::memcmp(frame.data(), fixed_reference.data(), frame_bytes) == 0;
+				failures += !exact;
+				printf("  %-7s %9.3f ms, %.1fx, %s (u%d phase)\n", BitpackISAName((BitpackISA)isa), packed.count() * 1000,
+					scalar.count() / packed.count(), exact ? "bit-exact" : "MISMATCH", bits);
+			};
+		};
+
+		// The same phases as doubles, read in place row-major, column-major (MATLAB's M x N x F)
+		// and row-major with padding between the holograms
+		for (int order = PHASE_ROW_MAJOR; order <= PHASE_COLUMN_MAJOR + 1; order++) {
+			const uint64_t plane_stride = order > PHASE_COLUMN_MAJOR ? c.N * c.M + 7 : 0;
+			const PhaseLayout layout = MakePhaseLayout(order > PHASE_COLUMN_MAJOR ? PHASE_ROW_MAJOR : (PhaseOrder)order, c.N, c.M, plane_stride);
+			std::vector<double> phase_f64(layout.plane_stride * c.num_holograms, -1.0);
+			for (int n = 0; n < c.num_holograms; n++) {
+				for (uint64_t j = 0; j < c.M; j++) {
+					for (uint64_t i = 0; i < c.N; i++) {
+						phase_f64[i * layout.pixel_stride + j * layout.row_stride + n * layout.plane_stride] = phase[i + j * c.N + n * c.N * c.M];
+					};
+				};
+			};
+			const char* name = order == PHASE_ROW_MAJOR ? "row-major" : order == PHASE_COLUMN_MAJOR ? "column-major" : "padded planes";
+
+			for (int isa = BITPACK_ISA_SCALAR; isa <= best; isa++) {
+				std::vector<uint8_t> frame(frame_bytes, 0xA5);
+
+				auto t1 = clock::now();
+				for (int r = 0; r < c.repeats; r++) {
+					BitpackHologramRows(phase_f64.data(), layout, frame.data(), c.N, c.M, c.num_holograms, quantiser, phase_map, 0, c.M, (BitpackISA)isa);
+				};
+				std::chrono::duration<double> packed = (clock::now() - t1) / c.repeats;
+
+				bool exact = std::memcmp(frame.data(), reference.data(), frame_bytes) == 0;
+				failures += !exact;
+				printf("  %-7s %9.3f ms, %.1fx, %s (f64 %s)\n", BitpackISAName((BitpackISA)isa), packed.count() * 1000,
+					scalar.count() / packed.count(), exact ? "bit-exact" : "MISMATCH", name);
+			};
+
+			std::vector<float> gathered(phase.size());
+			GatherPhases(phase_f64.data(), layout, gathered.data(), c.N, c.M, c.num_holograms);
+			bool exact = gathered == phase;
+			failures += !exact;
+			printf("  gather to float: %s (f64 %s)\n", exact ? "exact" : "MISMATCH", name);
+		};
+
+		// Float views: column-major, holograms interleaved per pixel (a NumPy (M, N, F) array)
+		// and rows in reverse order (a [::-1] slice), each read through its strides
+		for (int view = 0; view < 3; view++) {
+			const int64_t N = (int64_t)c.N, M = (int64_t)c.M, F = c.num_holograms;
+			PhaseLayout layout = MakePhaseLayout(PHASE_COLUMN_MAJOR, c.N, c.M);
+			if (view == 1) layout = { F, N * F, 1 };
+			if (view == 2) layout = { 1, -N, N * M };
+			int64_t first, last;
+			PhaseLayoutExtent(layout, c.N, c.M, c.num_holograms, first, last);
+			std::vector<float> storage(last - first + 1);
+			float* base = storage.data() - first;
+			for (int64_t n = 0; n < F; n++) {
+				for (int64_t j = 0; j < M; j++) {
+					for (int64_t i = 0; i < N; i++) {
+						base[i * layout.pixel_stride + j * layout.row_stride + n * layout.plane_stride] = phase[i + j * N + n * N * M];
+					};
+				};
+			};
+			const char* name = view == 0 ? "column-major" : view == 1 ? "interleaved" : "reversed rows";
+
+			for (int isa = BITPACK_ISA_SCALAR; isa <= best; isa++) {
+				std::vector<uint8_t> frame(frame_bytes, 0xA5);
+
+				auto t1 = clock::now();
+				for (int r = 0; r < c.repeats; r++) {
+					BitpackHologramRows((const float*)base, layout, frame.data(), c.N, c.M, c.num_holograms, quantiser, phase_map, 0, c.M, (BitpackISA)isa);
+				};
+				std::chrono::duration<double> packed = (clock::now() - t1) / c.repeats;
+
+				bool exact = std::memcmp(frame.data(), reference.data(), frame_bytes) == 0;
+				failures += !exact;
+				printf("  %-7s %9.3f ms, %.1fx, %s (f32 %s)\n", BitpackISAName((BitpackISA)isa), packed.count() * 1000,
+					scalar.count() / packed.count(), exact ? "bit-exact" : "MISMATCH", name);
+			};
+
+			std::vector<float> gathered(phase.size());
+			GatherPhases((const float*)base, layout, gathered.data(), c.N, c.M, c.num_holograms);
+			bool exact = gathered == phase;
+			failures += !exact;
+			printf("  gather to float: %s (f32 %s)\n", exact ? "exact" : "MISMATCH", name);
+		};
+
+		if (c.repeats == 1) continue;
+
+		ThreadPool pool;
+		const unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned int threads = 1; ; threads = std::min(2 * threads, max_threads)) {
+			pool.Resize(threads);
+			std::vector<uint8_t> frame(frame_bytes, 0xA5);
+
+			auto t1 = clock::now();
+			for (int r = 0; r < c.repeats; r++) {
+				BitpackHologramsParallel(pool, phase.data(), frame.data(), c.N, c.M, c.num_holograms, quantiser, phase_map);
+			};
+			std::chrono::duration<double> parallel = (clock::now() - t1) / c.repeats;
+
+			bool exact = std::memcmp(frame.data(), reference.data(), frame_bytes) == 0;
+			failures += !exact;
+			printf("  %2u threads %9.3f ms, %.1fx, %s\n", threads, parallel.count() * 1000,
+				scalar.count() / parallel.count(), exact ? "bit-exact" : "MISMATCH");
+
+			if (threads == max_threads) break;
+		};
+
+		PhaseQuantiser shuffled(shuffled_phases);
+		std::vector<uint8_t> frame(frame_bytes, 0xA5);
+		std::fill(reference.begin(), reference.end(), 0);
+		BitpackHologramsScalar(phase.data(), reference.data(), c.N, c.M, c.num_holograms, shuffled, phase_map, 0, c.M);
+		BitpackHologramsParallel(pool, phase.data(), frame.data(), c.N, c.M, c.num_holograms, shuffled, phase_map);
+		bool exact = std::memcmp(frame.data(), reference.data(), frame_bytes) == 0;
+		failures += !exact;
+		printf("  non-monotonic LUT: %s\n", exact ? "bit-exact" : "MISMATCH");
+	};
+
+	// Batch of 4 full frames and one with 5 holograms, into slots 2 to 6
+	{
+		const uint64_t N = 680, M = 400, offset = 2;
+		const uint64_t num_holograms = 4 * HOLOGRAMS_PER_FRAME + 5;
+		const uint64_t num_frames = (num_holograms + HOLOGRAMS_PER_FRAME - 1) / HOLOGRAMS_PER_FRAME;
+
+		PLMCore core;
+		core.ResetFrames(N, M, offset + num_frames + 1);
+		FrameStore& store = core.Frames();
+
+		std::vector<float> phase(N * M * num_holograms);
+		RandomPhase(rng, core.Quantiser(), phase);
+
+		auto t0 = clock::now();
+		bool batched = core.BitpackAndInsertBatch(phase.data(), N, M, num_holograms, offset);
+		std::chrono::duration<double> batch = clock::now() - t0;
+
+		int errors = !batched;
+		std::vector<uint8_t> rgba(4 * (2 * N) * (2 * M));
+		std::vector<uint8_t> rgb(store.FrameBytes());
+		for (uint64_t f = 0; f < num_frames && batched; f++) {
+			int holograms = (int)std::min<uint64_t>(HOLOGRAMS_PER_FRAME, num_holograms - f * HOLOGRAMS_PER_FRAME);
+			std::fill(rgba.begin(), rgba.end(), 0);
+			BitpackHologramsScalar(phase.data() + f * HOLOGRAMS_PER_FRAME * N * M, rgba.data(), N, M, holograms, core.Quantiser(), core.PhaseMap(), 0, M);
+			CompactRGBAToRGB(rgba.data(), rgb.data(), store.Width() * store.Height());
+			errors += std::memcmp(rgb.data(), store.Frame(offset + f), rgb.size()) != 0;
+		};
+		failures += errors != 0;
+
+		// The same frames one call at a time, as BitpackHolograms + InsertPLMFrame would
+		auto t1 = clock::now();
+		for (uint64_t f = 0; f < num_frames; f++) {
+			int holograms = (int)std::min<uint64_t>(HOLOGRAMS_PER_FRAME, num_holograms - f * HOLOGRAMS_PER_FRAME);
+			core.BitpackHolograms(phase.data() + f * HOLOGRAMS_PER_FRAME * N * M, rgba.data(), N, M, holograms);
+			store.Insert(rgba.data(), 1, offset + f, FRAME_FORMAT_RGBA);
+		};
+		std::chrono::duration<double> per_frame = clock::now() - t1;
+
+		printf("Batch of %llu holograms into %llu frames: %.3f ms, one frame per call %.3f ms, %s\n",
+			(unsigned long long)num_holograms, (unsigned long long)num_frames, batch.count() * 1000,
+			per_frame.count() * 1000, errors == 0 ? "bit-exact" : "MISMATCH");
+	};
+
+	// One frame packed straight into a slot, against packing to RGBA and inserting it
+	{
+		const uint64_t N = 1358, M = 800;
+
+		PLMCore core;
+		core.ResetFrames(N, M, 2);
+		FrameStore& store = core.Frames();
+
+		std::vector<float> phase(N * M * HOLOGRAMS_PER_FRAME);
+		RandomPhase(rng, core.Quantiser(), phase);
+		std::vector<uint8_t> rgba(4 * (2 * N) * (2 * M), 0);
+		BitpackHologramsScalar(phase.data(), rgba.data(), N, M, HOLOGRAMS_PER_FRAME, core.Quantiser(), core.PhaseMap(), 0, M);
+		std::vector<uint8_t> expected(store.FrameBytes());
+		CompactRGBAToRGB(rgba.data(), expected.data(), store.Width() * store.Height());
+
+		for (int isa = BITPACK_ISA_SCALAR; isa <= best; isa++) {
+			std::vector<uint8_t> frame(store.FrameBytes(), 0xA5);
+			auto t0 = clock::now();
+			BitpackHologramRowsRGB(phase.data(), frame.data(), store.Pitch(), N, M, HOLOGRAMS_PER_FRAME, core.Quantiser(), core.PhaseMap(), 0, M, (BitpackISA)isa);
+			std::chrono::duration<double> packed = clock::now() - t0;
+			bool exact = frame == expected;
+			failures += !exact;
+			printf("RGB frame %-7s %9.3f ms, %s\n", BitpackISAName((BitpackISA)isa), packed.count() * 1000, exact ? "bit-exact" : "MISMATCH");
+		};
+
+		auto t0 = clock::now();
+		bool inserted = core.BitpackAndInsert(phase.data(), N, M, HOLOGRAMS_PER_FRAME, 1);
+		std::chrono::duration<double> direct = clock::now() - t0;
+		bool exact = inserted && std::memcmp(store.Frame(1), expected.data(), expected.size()) == 0;
+		failures += !exact;
+
+		auto t1 = clock::now();
+		core.BitpackHolograms(phase.data(), rgba.data(), N, M, HOLOGRAMS_PER_FRAME);
+		store.Insert(rgba.data(), 1, 0, FRAME_FORMAT_RGBA);
+		std::chrono::duration<double> two_pass = clock::now() - t1;
+
+		printf("BitpackAndInsert %.3f ms, BitpackHolograms + Insert %.3f ms, %s\n", direct.count() * 1000, two_pass.count() * 1000,
+			exact ? "bit-exact" : "MISMATCH");
+	};
+
+	// Replace hologram 13 of a full frame in the store, against repacking all 24
+	{
+		const uint64_t N = 1358, M = 800;
+		const int plane = 13;
+
+		PLMCore core;
+		core.ResetFrames(N, M, 2);
+		FrameStore& store = core.Frames();
+
+		std::vector<float> phase(N * M * HOLOGRAMS_PER_FRAME);
+		RandomPhase(rng, core.Quantiser(), phase);
+		std::vector<uint8_t> rgba(4 * (2 * N) * (2 * M));
+		core.BitpackHolograms(phase.data(), rgba.data(), N, M, HOLOGRAMS_PER_FRAME);
+		store.Insert(rgba.data(), 1, 1, FRAME_FORMAT_RGBA);
+		const std::vector<uint8_t> original(store.Frame(1), store.Frame(1) + store.FrameBytes());
+
+		std::vector<float> update(N * M);
+		RandomPhase(rng, core.Quantiser(), update);
+		std::copy(update.begin(), update.end(), phase.begin() + plane * N * M);
+		std::fill(rgba.begin(), rgba.end(), 0);
+		BitpackHologramsScalar(phase.data(), rgba.data(), N, M, HOLOGRAMS_PER_FRAME, core.Quantiser(), core.PhaseMap(), 0, M);
+		std::vector<uint8_t> expected(store.FrameBytes());
+		CompactRGBAToRGB(rgba.data(), expected.data(), store.Width() * store.Height());
+
+		std::vector<uint8_t> levels(LevelBytes(LEVEL_FORMAT_NIBBLE, N * M), 0);
+		for (uint64_t e = 0; e < N * M; e++) levels[e / 2] |= core.Quantiser()(update[e]) << (4 * (e & 1));
+
+		for (int isa = BITPACK_ISA_SCALAR; isa <= best; isa++) {
+			std::vector<uint8_t> frame(original);
+			auto t0 = clock::now();
+			BitpackPlaneRows(update.data(), plane, frame.data(), store.Pitch(), N, M, core.Quantiser(), core.PhaseMap(), 0, M, (BitpackISA)isa);
+			std::chrono::duration<double> packed = clock::now() - t0;
+			bool exact = frame == expected;
+
+			frame = original;
+			BitpackLevelPlaneRows(levels.data(), LEVEL_FORMAT_NIBBLE, plane, frame.data(), store.Pitch(), N, M, core.PhaseMap(), 0, M, (BitpackISA)isa);
+			exact = exact && frame == expected;
+			failures += !exact;
+			printf("Plane update %-7s %9.3f ms, %s\n", BitpackISAName((BitpackISA)isa), packed.count() * 1000, exact ? "bit-exact" : "MISMATCH");
+		};
+
+		auto t0 = clock::now();
+		bool updated = core.UpdateHologramPlane(1, plane, update.data());
+		std::chrono::duration<double> single = clock::now() - t0;
+		bool exact = updated && std::memcmp(store.Frame(1), expected.data(), expected.size()) == 0;
+		failures += !exact;
+
+		auto t1 = clock::now();
+		core.BitpackHolograms(phase.data(), rgba.data(), N, M, HOLOGRAMS_PER_FRAME);
+		store.Insert(rgba.data(), 1, 1, FRAME_FORMAT_RGBA);
+		std::chrono::duration<double> full = clock::now() - t1;
+
+		printf("UpdateHologramPlane %.3f ms, full repack and insert %.3f ms, %s\n", single.count() * 1000, full.count() * 1000,
+			exact ? "bit-exact" : "MISMATCH");
+	};
+
+	// Insert 8 full-size RGB and RGBA frames, and a small odd-sized one from a misaligned buffer
+	{
+		const uint64_t sizes[2][3] = { { 1358, 800, 8 }, { 7, 5, 3 } };
+
+		for (const auto& size : sizes) {
+			const uint64_t N = size[0], M = size[1], num_frames = size[2];
+
+			PLMCore core;
+			core.ResetFrames(N, M, num_frames + 1);
+			FrameStore& store = core.Frames();
+			const uint64_t texels = num_frames * store.Width() * store.Height();
+
+			std::uniform_int_distribution<int> byte(0, 255);
+			std::vector<uint8_t> rgba(4 * texels + 1);
+			for (auto& v : rgba) v = (uint8_t)byte(rng);
+			std::vector<uint8_t> rgb(3 * texels), expected_rgba(4 * texels);
+			for (uint64_t i = 0; i < texels; i++) {
+				for (int c = 0; c < 3; c++) rgb[3 * i + c] = rgba[1 + 4 * i + c];
+				std::memcpy(&expected_rgba[4 * i], &rgba[1 + 4 * i], 3);
+				expected_rgba[4 * i + 3] = 255;
+			};
+
+			// Commit the slots' pages first, so the timings are of the copies
+			store.Insert(rgb.data(), num_frames, 1, FRAME_FORMAT_RGB);
+
+			for (FrameFormat format : { FRAME_FORMAT_RGB, FRAME_FORMAT_RGBA }) {
+				const uint8_t* src = format == FRAME_FORMAT_RGB ? rgb.data() : rgba.data() + 1;
+				const char* name = format == FRAME_FORMAT_RGB ? "RGB" : "RGBA";
+
+				auto t0 = clock::now();
+				bool inserted = store.Insert(src, num_frames, 1, format);
+				std::chrono::duration<double> single = clock::now() - t0;
+				bool exact = inserted && std::memcmp(store.Frame(1), rgb.data(), rgb.size()) == 0;
+
+				std::fill(store.Frame(1), store.Frame(1) + rgb.size(), 0);
+				auto t1 = clock::now();
+				inserted = core.InsertFrames(src, num_frames, 1, format);
+				std::chrono::duration<double> pooled = clock::now() - t1;
+				exact = exact && inserted && std::memcmp(store.Frame(1), rgb.data(), rgb.size()) == 0;
+
+				std::vector<uint8_t> read(4 * store.Width() * store.Height());
+				for (uint64_t f = 0; f < num_frames && exact; f++) {
+					exact = store.Read(1 + f, read.data()) && std::equal(read.begin(), read.end(), expected_rgba.begin() + f * read.size());
+				};
+				failures += !exact;
+
+				printf("Insert %llu %-4s frames %llux%llu: %.3f ms, %u threads %.3f ms, %s\n", (unsigned long long)num_frames, name,
+					(unsigned long long)store.Width(), (unsigned long long)store.Height(), single.count() * 1000,
+					core.BitpackPool().Size(), pooled.count() * 1000, exact ? "bit-exact" : "MISMATCH");
+			};
+		};
+	};
+
+	return failures == 0 ? 0 : 1;
+}
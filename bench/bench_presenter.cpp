@@ -0,0 +1,354 @@
+// Sequencing and frame-pacing benchmark on the headless presenter.
+// Plays a shuffled sequence through the same sequencer the UI loop uses and checks that
+// every vsync shows the expected slot and buffer index. Then measures presenter
+// throughput with and without texture uploads, and the pacing jitter of a simulated
+// 60 Hz display. A slot on display is leased and written in place, and must only be
+// uploaded again once it's committed. Sequences are started from a second thread while a
+// third polls the sequencer status, a sequence much longer than the store is played, and
+// so is one whose frames are held for several vsyncs each. The store is then grown and
+// shrunk between vsyncs. Finally a large store is created and the time to its first
+// present measured, against filling every slot up front.
+//
+// Build (from the repository root):
+//   g++ -O3 -std=c++17 -Icore bench/bench_presenter.cpp core/headless_presenter.cpp core/sequencer.cpp core/frame_store.cpp core/bitpack.cpp core/quantiser.cpp core/thread_pool.cpp -pthread -o bench_presenter
+
+#include "headless_presenter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const uint64_t N = 1358, M = 800;
+
+// Checks a sequence started on vsync start_vsync against the order it was played with
+static int CheckSequence(const std::vector<PresentRecord>& log, const std::vector<uint64_t>& order, uint64_t start_vsync, int frames) {
+
+	int errors = 0;
+	int started = 0, stopped = 0;
+
+	for (const PresentRecord& r : log) {
+		started += r.plm_started;
+		stopped += r.plm_stopped;
+
+		if (r.vsync <= start_vsync) continue;
+		int64_t position = (int64_t)(r.vsync - start_vsync - 1);
+		if (position < frames) {
+			// Frame k of the sequence goes out on the k-th vsync after the start, with buffer index k
+			if (r.slot != order[position] || r.buffer_index != position || r.plm_started != (position == 0)) {
+				printf("  vsync %llu: slot %llu, buffer index %lld, expected slot %llu, buffer index %lld\n",
+					(unsigned long long)r.vsync, (unsigned long long)r.slot, (long long)r.buffer_index,
+					(unsigned long long)order[position], (long long)position);
+				errors++;
+			};
+		};
+	};
+
+	if (started != 1 || stopped != 1) {
+		printf("  PLM started %d times and stopped %d times, expected once each\n", started, stopped);
+		errors++;
+	};
+	if (log.back().buffer_index != -1) {
+		printf("  buffer index %lld after the sequence, expected -1\n", (long long)log.back().buffer_index);
+		errors++;
+	};
+
+	return errors;
+}
+
+int main(int argc, char** argv) {
+
+	const int num_frames = argc > 1 ? atoi(argv[1]) : 16;
+
+	FrameStore store;
+	store.Resize(2 * N, 2 * M, num_frames);
+	for (int i = 0; i < num_frames; i++) {
+		std::fill(store.Frame(i), store.Frame(i) + store.FrameBytes(), (uint8_t)i);
+		store.Touch(i);
+	};
+
+	Sequencer sequencer;
+	sequencer.Reset(num_frames);
+
+	std::vector<uint64_t> order(num_frames);
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), std::mt19937(7));
+	sequencer.SetOrder(order.data(), order.size());
+
+	int failures = 0;
+	using clock = std::chrono::high_resolution_clock;
+
+	// Sequence correctness, started from the callback so it lands on a known vsync
+	{
+		HeadlessPresenter presenter(store, sequencer);
+		const uint64_t start_vsync = 10;
+		presenter.SetCallback([&](const PresentRecord& r) {
+			if (r.vsync == start_vsync) sequencer.Start(num_frames);
+		});
+
+		auto t0 = clock::now();
+		presenter.Run(start_vsync + num_frames + 10);
+		std::chrono::duration<double> elapsed = clock::now() - t0;
+
+		int errors = CheckSequence(presenter.Log(), order, start_vsync, num_frames);
+		failures += errors != 0;
+		printf("Sequence of %d frames: %s, %llu uploads, %llu skipped, %.2f ms per vsync\n", num_frames,
+			errors == 0 ? "correct" : "WRONG", (unsigned long long)presenter.Uploads(),
+			(unsigned long long)presenter.UploadsSkipped(), elapsed.count() * 1000 / presenter.Log().size());
+	};
+
+	// Throughput holding a single frame, nothing to upload after the first vsync
+	{
+		sequencer.SetFrame(0);
+		HeadlessPresenter presenter(store, sequencer);
+		presenter.Run(1);
+
+		const uint64_t vsyncs = 100000;
+		auto t0 = clock::now();
+		presenter.Run(vsyncs);
+		std::chrono::duration<double> elapsed = clock::now() - t0;
+		printf("Static frame: %.3f us per vsync, %llu uploads\n", elapsed.count() * 1e6 / vsyncs,
+			(unsigned long long)presenter.Uploads());
+	};
+
+	// Pacing at 60 Hz
+	{
+		HeadlessPresenter presenter(store, sequencer);
+		presenter.SetPaced(true);
+		presenter.SetRefreshRate(60.0);
+		presenter.Run(120);
+
+		double worst = 0.0, sum = 0.0;
+		for (const PresentRecord& r : presenter.Log()) {
+			double lateness = r.wall_time - r.time;
+			worst = std::max(worst, lateness);
+			sum += lateness;
+		};
+		printf("Paced 60 Hz: mean lateness %.3f ms, worst %.3f ms over %zu vsyncs\n",
+			sum * 1000 / presenter.Log().size(), worst * 1000, presenter.Log().size());
+	};
+
+	// Slot leasing: no uploads while the slot on display is being written, one after the commit
+	{
+		sequencer.SetFrame(0);
+		HeadlessPresenter presenter(store, sequencer);
+		presenter.Run(1);
+		const uint64_t slot = sequencer.Slot();
+
+		uint8_t* frame = store.Acquire(slot);
+		bool ok = frame != nullptr && store.Acquire(slot) == nullptr;
+		std::fill(frame, frame + store.FrameBytes(), (uint8_t)0xA5);
+		presenter.Run(5);
+		ok = ok && presenter.Uploads() == 1;
+
+		ok = ok && store.Commit(slot) && !store.Commit(slot);
+		presenter.Run(5);
+		ok = ok && presenter.Uploads() == 2;
+		failures += !ok;
+		printf("Leased slot: %llu uploads over 11 vsyncs, %s\n", (unsigned long long)presenter.Uploads(), ok ? "correct" : "WRONG");
+	};
+
+	// Sequences started from another thread while a poller reads the status in a tight loop.
+	// Every snapshot has to be consistent, and every sequence played in full.
+	{
+		sequencer.SetFrame(0);
+		HeadlessPresenter presenter(store, sequencer);
+		presenter.SetPaced(true);
+		presenter.SetRefreshRate(2000.0);
+		presenter.SetSequenceEndDelay(0);
+
+		std::atomic<bool> polling{ true };
+		uint64_t snapshots = 0, torn = 0;
+		double snapshot_time = 0.0;
+		std::thread poller([&] {
+			auto t0 = clock::now();
+			while (polling) {
+				SequencerStatus status = sequencer.Status();
+				const bool in_order = status.positions == (uint64_t)num_frames && status.slot == order[status.frame_index % num_frames];
+				const bool in_sequence = !status.camera_trigger || status.buffer_index == status.frames_in_sequence - status.frames_to_play - 1;
+				torn += !(in_order && in_sequence);
+				snapshots++;
+			};
+			snapshot_time = std::chrono::duration<double>(clock::now() - t0).count();
+		});
+
+		const int sequences = 20;
+		std::thread producer([&] {
+			for (int k = 0; k < sequences; k++) {
+				while (sequencer.Status().active) std::this_thread::yield();
+				sequencer.Start(num_frames);
+				// Let the start be applied before checking for the end of the sequence
+				while (!sequencer.Status().active) std::this_thread::yield();
+			};
+		});
+
+		uint64_t started = 0;
+		while (started < (uint64_t)sequences) {
+			presenter.Run(1);
+			started += presenter.Log().back().plm_started;
+		};
+		presenter.Run(num_frames + 2);
+		producer.join();
+		polling = false;
+		poller.join();
+
+		// Each start shows position 0 on the vsync after it was applied, then the whole order
+		int errors = 0;
+		const std::vector<PresentRecord>& log = presenter.Log();
+		for (size_t i = 0; i < log.size(); i++) {
+			if (!log[i].plm_started) continue;
+			for (int k = 0; k < num_frames && i + k < log.size(); k++) {
+				errors += log[i + k].slot != order[k] || log[i + k].buffer_index != k;
+			};
+		};
+
+		const bool ok = errors == 0 && torn == 0;
+		failures += !ok;
+		printf("%d sequences started from another thread: %s, %llu snapshots polled, %llu torn, %.1f ns per snapshot\n", sequences,
+			errors == 0 ? "correct" : "WRONG", (unsigned long long)snapshots, (unsigned long long)torn, snapshot_time * 1e9 / std::max<uint64_t>(snapshots, 1));
+	};
+
+	// A scan 40 times longer than the store, revisiting its slots. Only slot changes are uploaded.
+	{
+		const int steps = 40 * num_frames;
+		std::vector<uint64_t> scan(steps);
+		std::mt19937 rng(11);
+		for (uint64_t& slot : scan) slot = rng() % num_frames;
+
+		Sequencer scan_sequencer;
+		scan_sequencer.Reset(num_frames);
+		bool ok = scan_sequencer.SetOrder(scan.data(), scan.size()) && scan_sequencer.Start(steps);
+
+		HeadlessPresenter presenter(store, scan_sequencer);
+		presenter.Run(steps + 2);
+
+		uint64_t changes = 0;
+		for (int k = 0; k < steps; k++) {
+			const PresentRecord& r = presenter.Log()[k];
+			ok = ok && r.slot == scan[k] && r.buffer_index == k;
+			changes += k == 0 || scan[k] != scan[k - 1];
+		};
+		ok = ok && presenter.Uploads() <= changes + 1;
+		failures += !ok;
+		printf("Scan of %d steps over %d slots: %s, %llu uploads\n", steps, num_frames, ok ? "correct" : "WRONG",
+			(unsigned long long)presenter.Uploads());
+	};
+
+	// Dwell counts: each position is held for 1-4 vsyncs, uploaded once, and the buffer index
+	// still counts every vsync
+	{
+		std::vector<uint32_t> dwell(num_frames);
+		std::vector<uint64_t> expected;
+		for (int k = 0; k < num_frames; k++) {
+			dwell[k] = 1 + k % 4;
+			expected.insert(expected.end(), dwell[k], order[k]);
+		};
+
+		Sequencer dwell_sequencer;
+		dwell_sequencer.Reset(num_frames);
+		bool ok = dwell_sequencer.SetOrder(order.data(), order.size(), dwell.data()) && dwell_sequencer.Start(num_frames);
+
+		HeadlessPresenter presenter(store, dwell_sequencer);
+		presenter.Run(expected.size() + 3);
+
+		int started = 0;
+		for (size_t v = 0; v < presenter.Log().size(); v++) {
+			const PresentRecord& r = presenter.Log()[v];
+			started += r.plm_started;
+			if (v < expected.size()) ok = ok && r.slot == expected[v] && r.buffer_index == (int64_t)v;
+		};
+		ok = ok && started == 1 && presenter.Log().back().buffer_index == -1 && presenter.Uploads() == (uint64_t)num_frames;
+		failures += !ok;
+		printf("Sequence of %d frames held for %zu vsyncs: %s, %llu uploads\n", num_frames, expected.size(), ok ? "correct" : "WRONG",
+			(unsigned long long)presenter.Uploads());
+	};
+
+	// Grow and shrink the store between vsyncs, the frames and order that fit are kept
+	{
+		FrameStore resized;
+		resized.Resize(2 * N, 2 * M, num_frames);
+		for (int i = 0; i < num_frames; i++) std::fill(resized.Frame(i), resized.Frame(i) + resized.FrameBytes(), (uint8_t)i);
+		Sequencer resized_sequencer;
+		resized_sequencer.Reset(num_frames);
+		resized_sequencer.SetOrder(order.data(), order.size());
+		resized_sequencer.SetFrame(1);
+
+		HeadlessPresenter presenter(resized, resized_sequencer);
+		presenter.Run(2);
+		const uint64_t uploads = presenter.Uploads();
+
+		// Not while another thread holds slot pointers
+		bool ok = true;
+		{
+			auto frames_lock = resized.LockFrames();
+			std::thread([&] { ok = !resized.ResizeFrames(2 * num_frames); }).join();
+		};
+
+		auto t0 = clock::now();
+		ok = ok && resized.ResizeFrames(2 * num_frames) && resized_sequencer.Resize(2 * num_frames);
+		std::chrono::duration<double> grow = clock::now() - t0;
+		presenter.Run(2);
+		// The slot on display kept its generation, so it isn't uploaded again
+		ok = ok && presenter.Uploads() == uploads && resized.IsBlank(num_frames) && resized_sequencer.Order()[num_frames] == (uint64_t)num_frames;
+
+		const uint64_t shrunk = num_frames / 2;
+		auto t1 = clock::now();
+		ok = ok && resized.ResizeFrames(shrunk) && resized_sequencer.Resize(shrunk);
+		std::chrono::duration<double> shrink = clock::now() - t1;
+		presenter.Run(2);
+		for (uint64_t i = 0; i < shrunk && ok; i++) {
+			ok = resized.Frame(i)[resized.FrameBytes() - 1] == (uint8_t)i
+				&& resized_sequencer.Order()[i] == (order[i] < shrunk ? order[i] : i);
+		};
+
+		// An order queued before the store shrinks is remapped when applied, not dropped
+		std::vector<uint64_t> late(shrunk);
+		for (uint64_t i = 0; i < shrunk; i++) late[i] = shrunk - 1 - i;
+		const uint64_t smallest = std::max<uint64_t>(1, shrunk / 2);
+		ok = ok && resized_sequencer.SetOrder(late.data(), late.size());
+		ok = ok && resized.ResizeFrames(smallest) && resized_sequencer.Resize(smallest);
+		presenter.Run(1);
+		ok = ok && resized_sequencer.Order().size() == shrunk;
+		for (uint64_t i = 0; i < shrunk && ok; i++) {
+			ok = resized_sequencer.Order()[i] == (late[i] < smallest ? late[i] : i % smallest);
+		};
+		failures += !ok;
+		printf("Resize %d -> %d -> %llu frames: %.2f ms, %.2f ms, %s\n", num_frames, 2 * num_frames, (unsigned long long)shrunk,
+			grow.count() * 1000, shrink.count() * 1000, ok ? "kept" : "WRONG");
+	};
+
+	// Time from allocating a 64-frame store to the first present, slots are only filled when used
+	{
+		const uint64_t large_frames = 64;
+		Sequencer large_sequencer;
+		large_sequencer.Reset(large_frames);
+
+		auto t0 = clock::now();
+		FrameStore large;
+		large.Resize(2 * N, 2 * M, large_frames);
+		HeadlessPresenter presenter(large, large_sequencer);
+		presenter.Run(1);
+		std::chrono::duration<double> lazy = clock::now() - t0;
+
+		std::vector<uint8_t> rgba(4 * large.Width() * large.Height());
+		// Presenting a blank slot doesn't fill it
+		bool ok = large.IsBlank(0) && presenter.Uploads() == 1 && large.IsBlank(1) && large.Read(1, rgba.data()) && !large.IsBlank(1)
+			&& std::all_of(rgba.begin(), rgba.end(), [](uint8_t v) { return v == 255; });
+		failures += !ok;
+
+		auto t1 = clock::now();
+		for (uint64_t i = 0; i < large_frames; i++) large.Frame(i);
+		std::chrono::duration<double> filled = clock::now() - t1;
+
+		printf("%llu-frame store to first present: %.2f ms, filling every slot %.2f ms, %s\n", (unsigned long long)large_frames,
+			lazy.count() * 1000, filled.count() * 1000, ok ? "correct" : "WRONG");
+	};
+
+	return failures == 0 ? 0 : 1;
+}
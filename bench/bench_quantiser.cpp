@@ -0,0 +1,110 @@
+// Micro-benchmark for the phase quantiser.
+// Compares the table-driven PhaseQuantiser against the reference nearest-level scan
+// (QuantisePhaseScan) on a frame worth of phase values, and checks that both agree.
+//
+// Build (from the repository root):
+//   g++ -O3 -std=c++17 -Icore bench/bench_quantiser.cpp core/quantiser.cpp -o bench_quantiser
+// Run with --exhaustive to also compare every float in [0, 1) (takes a while).
+
+#include "quantiser.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// TI's default lookup-table, the one plmctrl starts with
+static const float ti_phases[QUANTISER_LUT_SIZE] = { 0, 0.0100, 0.0205, 0.0422, 0.0560, 0.0727, 0.1131, 0.1734, 0.3426, 0.3707, 0.4228, 0.4916, 0.5994, 0.6671, 0.7970, 0.9375, 1.0 };
+// Calibrated lookup-table from matlab_example.m
+static const float calibrated_phases[QUANTISER_LUT_SIZE] = { 0.004f, 0.017f, 0.036f, 0.058f, 0.085f, 0.117f, 0.157f, 0.217f, 0.296f, 0.4f, 0.5f, 0.605f, 0.713f, 0.82f, 0.922f, 0.981f, 1.0f };
+
+static uint64_t CompareOn(const PhaseQuantiser& quantiser, const float* phases, const std::vector<float>& values) {
+	uint64_t mismatches = 0;
+	for (float v : values) {
+		if (quantiser(v) != QuantisePhaseScan(phases, v)) mismatches++;
+	};
+	return mismatches;
+}
+
+static uint64_t CompareExhaustive(const PhaseQuantiser& quantiser, const float* phases) {
+	uint64_t mismatches = 0;
+	for (float v = 0.0f; v < 1.0f; v = std::nextafter(v, 2.0f)) {
+		if (quantiser(v) != QuantisePhaseScan(phases, v)) mismatches++;
+	};
+	return mismatches;
+}
+
+static int Run(const char* name, const float* phases, bool exhaustive) {
+
+	const uint64_t N = 1358, M = 800, num_holograms = 24;
+	const uint64_t count = N * M * num_holograms;
+
+	PhaseQuantiser quantiser(phases);
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	std::vector<float> values(count);
+	for (auto& v : values) v = uniform(rng);
+
+	// Values on and around every decision point, plus a few out of range ones
+	std::vector<float> edges = { -1.0f, -0.0f, 0.0f, 1.0f, 1.5f, NAN, INFINITY, -INFINITY };
+	for (int k = 0; k < QUANTISER_LEVELS; k++) {
+		for (float v : { quantiser.Thresholds()[k], phases[k], phases[k + 1] }) {
+			edges.push_back(v);
+			edges.push_back(std::nextafter(v, -2.0f));
+			edges.push_back(std::nextafter(v, 2.0f));
+		};
+	};
+	for (uint32_t bin = 0; bin <= QUANTISER_TABLE_SIZE; bin++) {
+		float v = (float)bin / (float)QUANTISER_TABLE_SIZE;
+		edges.push_back(v);
+		edges.push_back(std::nextafter(v, -2.0f));
+	};
+
+	uint64_t mismatches = CompareOn(quantiser, phases, values) + CompareOn(quantiser, phases, edges);
+	if (exhaustive) mismatches += CompareExhaustive(quantiser, phases);
+
+	using clock = std::chrono::high_resolution_clock;
+	volatile unsigned int sink = 0;
+	unsigned int acc = 0;
+
+	auto t0 = clock::now();
+	for (float v : values) acc += QuantisePhaseScan(phases, v);
+	auto t1 = clock::now();
+	sink = acc;
+	acc = 0;
+	for (float v : values) acc += quantiser(v);
+	auto t2 = clock::now();
+	sink = acc;
+	(void)sink;
+
+	std::chrono::duration<double> scan = t1 - t0;
+	std::chrono::duration<double> table = t2 - t1;
+	auto build_start = clock::now();
+	quantiser.Build(phases);
+	std::chrono::duration<double> build = clock::now() - build_start;
+
+	printf("[%s] %llu values, %u split bins, build %.3f ms\n", name, (unsigned long long)count, quantiser.SplitBins(), build.count() * 1000);
+	printf("  scan : %8.2f ms (%.2f ns/value)\n", scan.count() * 1000, scan.count() * 1e9 / count);
+	printf("  table: %8.2f ms (%.2f ns/value), %.1fx\n", table.count() * 1000, table.count() * 1e9 / count, scan.count() / table.count());
+	printf("  mismatches: %llu\n", (unsigned long long)mismatches);
+
+	return mismatches == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+
+	bool exhaustive = argc > 1 && strcmp(argv[1], "--exhaustive") == 0;
+
+	float linear_phases[QUANTISER_LUT_SIZE];
+	for (int i = 0; i < QUANTISER_LUT_SIZE; i++) linear_phases[i] = (float)i / QUANTISER_LEVELS;
+
+	int res = 0;
+	res |= Run("TI", ti_phases, exhaustive);
+	res |= Run("calibrated", calibrated_phases, exhaustive);
+	res |= Run("linear", linear_phases, exhaustive);
+
+	return res;
+}
@@ -0,0 +1,1356 @@
+#include "bitpack.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+const char* BitpackISAName(BitpackISA isa) {
+	switch (isa) {
+	case BITPACK_ISA_AVX2: return "AVX2";
+	case BITPACK_ISA_SSE41: return "SSE4.1";
+	default: return "Scalar";
+	}
+}
+
+#ifdef PLM_X86
+static void CPUID(int leaf, int subleaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, leaf, subleaf);
+	for (int i = 0; i < 4; i++) regs[i] = (unsigned int)r[i];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t XGETBV() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+static BitpackISA QueryBitpackISA() {
+#ifdef PLM_X86
+	unsigned int regs[4];
+	CPUID(0, 0, regs);
+	const unsigned int max_leaf = regs[0];
+
+	CPUID(1, 0, regs);
+	const bool sse41 = regs[2] & (1u << 19);
+	const bool osxsave = regs[2] & (1u << 27);
+	const bool avx = regs[2] & (1u << 28);
+
+	bool avx2 = false;
+	// The OS has to save the YMM registers for AVX to be usable
+	if (osxsave && avx && (XGETBV() & 0x6) == 0x6 && max_leaf >= 7) {
+		CPUID(7, 0, regs);
+		avx2 = regs[1] & (1u << 5);
+	};
+
+	if (avx2) return BITPACK_ISA_AVX2;
+	if (sse41) return BITPACK_ISA_SSE41;
+#endif
+	return BITPACK_ISA_SCALAR;
+}
+
+BitpackISA DetectBitpackISA() {
+	static const BitpackISA isa = QueryBitpackISA();
+	return isa;
+}
+
+void BitpackHologramsScalar(
+	const float* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end
+) {
+	uint64_t phase_elements = N * M;
+	uint64_t color_id = 0;
+	uint64_t offset = 0;
+	unsigned int level = 0;
+
+	for (int n = 0; n < num_holograms; n++) {
+
+		color_id = n % 24 / 8;
+		offset = n % 8;
+
+		for (uint64_t j = row_begin; j < row_end; j++) {
+			for (uint64_t i = 0; i < N; i++) {
+				// Quantize the phase values
+				level = quantiser(phase[i + j * N + n * phase_elements]);
+				// Encode the phase values into the hologram
+				hologram[4 * (2 * i + 0) + (2 * j + 1) * (4 * 2 * N) + color_id] |= phase_map[level * 4 + 0] << offset;
+				hologram[4 * (2 * i + 0) + (2 * j + 0) * (4 * 2 * N) + color_id] |= phase_map[level * 4 + 1] << offset;
+				hologram[4 * (2 * i + 1) + (2 * j + 1) * (4 * 2 * N) + color_id] |= phase_map[level * 4 + 2] << offset;
+				hologram[4 * (2 * i + 1) + (2 * j + 0) * (4 * 2 * N) + color_id] |= phase_map[level * 4 + 3] << offset;
+
+				hologram[4 * (2 * i + 0) + (2 * j + 1) * (4 * 2 * N) + 3] = 255;
+				hologram[4 * (2 * i + 0) + (2 * j + 0) * (4 * 2 * N) + 3] = 255;
+				hologram[4 * (2 * i + 1) + (2 * j + 1) * (4 * 2 * N) + 3] = 255;
+				hologram[4 * (2 * i + 1) + (2 * j + 0) * (4 * 2 * N) + 3] = 255;
+			};
+		};
+	}
+}
+
+// The pixel-major kernels keep, for every pixel and colour channel, one 32-bit word whose
+// bytes are the channel values of the four output texels, ordered as they are stored:
+//   byte 0 -> k = 1 (2i, 2j),   byte 1 -> k = 3 (2i+1, 2j),
+//   byte 2 -> k = 0 (2i, 2j+1), byte 3 -> k = 2 (2i+1, 2j+1)
+// so the low half of a pixel's texels goes to row 2j and the high half to row 2j+1.
+struct BitpackTables {
+	uint32_t spread[QUANTISER_LEVELS];   // Phase map bits of each level, one per byte
+	uint8_t nibble[QUANTISER_LEVELS];    // Same bits packed into a nibble (bit b -> byte b)
+};
+
+static void BuildBitpackTables(const int* phase_map, BitpackTables& tables) {
+	const int byte_to_k[4] = { 1, 3, 0, 2 };
+	for (int level = 0; level < QUANTISER_LEVELS; level++) {
+		tables.spread[level] = 0;
+		tables.nibble[level] = 0;
+		for (int b = 0; b < 4; b++) {
+			uint32_t bit = phase_map[level * 4 + byte_to_k[b]] & 1;
+			tables.spread[level] |= bit << (8 * b);
+			tables.nibble[level] |= (uint8_t)(bit << b);
+		};
+	};
+}
+
+static inline uint32_t Texel(const uint32_t* acc, int b) {
+	return ((acc[0] >> (8 * b)) & 0xFF)
+		| ((acc[1] >> (8 * b)) & 0xFF) << 8
+		| ((acc[2] >> (8 * b)) & 0xFF) << 16
+		| 0xFF000000u;
+}
+
+// Writes the 4 texels of pixel i, two to each output row, as RGBA (texel_bytes 4) or as
+// packed RGB (texel_bytes 3, the frame store layout)
+template <int texel_bytes>
+static inline void StorePixel(const uint32_t* acc, uint8_t* row0, uint8_t* row1, uint64_t i) {
+	uint32_t texels[4] = { Texel(acc, 0), Texel(acc, 1), Texel(acc, 2), Texel(acc, 3) };
+	if (texel_bytes == 4) {
+		std::memcpy(row0 + 8 * i, &texels[0], 8);
+		std::memcpy(row1 + 8 * i, &texels[2], 8);
+	} else {
+		for (int t = 0; t < 2; t++) {
+			std::memcpy(row0 + 3 * (2 * i + t), &texels[t], 3);
+			std::memcpy(row1 + 3 * (2 * i + t), &texels[2 + t], 3);
+		};
+	};
+}
+
+// Packs pixels [i_begin, i_end) of one phase row, one pixel at a time
+template <typename T, int texel_bytes = 4>
+static void PackRowScalar(
+	const T* row_phase,
+	uint64_t plane_elements,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t i_begin,
+	uint64_t i_end
+) {
+	for (uint64_t i = i_begin; i < i_end; i++) {
+		uint32_t acc[3] = { 0, 0, 0 };
+		for (int n = 0; n < num_holograms; n++) {
+			acc[n / 8] |= tables.spread[quantiser(row_phase[i + n * plane_elements])] << (n % 8);
+		};
+		StorePixel<texel_bytes>(acc, row0, row1, i);
+	};
+}
+
+static inline unsigned int Level(const uint8_t* levels, LevelFormat format, uint64_t e) {
+	unsigned int level = format == LEVEL_FORMAT_U8 ? levels[e] : levels[e / 2] >> (4 * (e & 1));
+	return level & (QUANTISER_LEVELS - 1);
+}
+
+// Packs pixels [i_begin, i_end) of one row of levels, the row starting at element row_element
+static void PackLevelRowScalar(
+	const uint8_t* levels,
+	LevelFormat format,
+	uint64_t row_element,
+	uint64_t plane_elements,
+	int num_holograms,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t i_begin,
+	uint64_t i_end
+) {
+	for (uint64_t i = i_begin; i < i_end; i++) {
+		uint32_t acc[3] = { 0, 0, 0 };
+		for (int n = 0; n < num_holograms; n++) {
+			acc[n / 8] |= tables.spread[Level(levels, format, row_element + i + n * plane_elements)] << (n % 8);
+		};
+		StorePixel<4>(acc, row0, row1, i);
+	};
+}
+
+// Packs pixels [i_begin, i_end) of one phase row read through layout, rounding each value to float
+template <typename T>
+static void PackStridedRowScalar(
+	const T* row_phase,
+	const PhaseLayout& layout,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t i_begin,
+	uint64_t i_end
+) {
+	for (uint64_t i = i_begin; i < i_end; i++) {
+		const T* pixel = row_phase + (int64_t)i * layout.pixel_stride;
+		uint32_t acc[3] = { 0, 0, 0 };
+		for (int n = 0; n < num_holograms; n++) {
+			acc[n / 8] |= tables.spread[quantiser((float)pixel[n * layout.plane_stride])] << (n % 8);
+		};
+		StorePixel<4>(acc, row0, row1, i);
+	};
+}
+
+#ifdef PLM_X86
+// Output rows are written once and not read back by the packer, so when they're 16-byte
+// aligned we bypass the cache with non-temporal stores.
+PLM_TARGET("sse4.1")
+static inline void Store128(uint8_t* dest, __m128i v, bool stream) {
+	if (stream) {
+		_mm_stream_si128((__m128i*)dest, v);
+	} else {
+		_mm_storeu_si128((__m128i*)dest, v);
+	};
+}
+
+PLM_TARGET("avx2")
+static inline void Store256(uint8_t* dest, __m256i v, bool stream) {
+	if (stream) {
+		_mm_stream_si128((__m128i*)dest, _mm256_castsi256_si128(v));
+		_mm_stream_si128((__m128i*)(dest + 16), _mm256_extracti128_si256(v, 1));
+	} else {
+		_mm256_storeu_si256((__m256i*)dest, v);
+	};
+}
+
+// Phase map nibble of each level, spread to one bit per byte of its 32-bit lane
+PLM_TARGET("sse4.1")
+static inline __m128i LevelBitsSSE41(__m128i level, __m128i nibble_table) {
+	__m128i bits = _mm_and_si128(_mm_shuffle_epi8(nibble_table, level), _mm_set1_epi32(0xFF));
+	return _mm_and_si128(_mm_mullo_epi32(bits, _mm_set1_epi32(0x00204081)), _mm_set1_epi32(0x01010101));
+}
+
+// Interleaves the three channels and alpha into the 4 texels of each of 4 pixels:
+// rows[0] and rows[1] go to output row 2j, rows[2] and rows[3] to row 2j+1
+PLM_TARGET("sse4.1")
+static inline void InterleaveTexelsSSE41(const __m128i* acc, __m128i* rows) {
+	const __m128i alpha = _mm_set1_epi8((char)0xFF);
+	__m128i rg_lo = _mm_unpacklo_epi8(acc[0], acc[1]);
+	__m128i rg_hi = _mm_unpackhi_epi8(acc[0], acc[1]);
+	__m128i ba_lo = _mm_unpacklo_epi8(acc[2], alpha);
+	__m128i ba_hi = _mm_unpackhi_epi8(acc[2], alpha);
+	__m128i p0 = _mm_unpacklo_epi16(rg_lo, ba_lo);
+	__m128i p1 = _mm_unpackhi_epi16(rg_lo, ba_lo);
+	__m128i p2 = _mm_unpacklo_epi16(rg_hi, ba_hi);
+	__m128i p3 = _mm_unpackhi_epi16(rg_hi, ba_hi);
+
+	rows[0] = _mm_unpacklo_epi64(p0, p1);
+	rows[1] = _mm_unpacklo_epi64(p2, p3);
+	rows[2] = _mm_unpackhi_epi64(p0, p1);
+	rows[3] = _mm_unpackhi_epi64(p2, p3);
+}
+
+PLM_TARGET("sse4.1")
+static inline void StoreTexelsSSE41(const __m128i* acc, uint8_t* row0, uint8_t* row1, bool stream) {
+	__m128i rows[4];
+	InterleaveTexelsSSE41(acc, rows);
+
+	Store128(row0, rows[0], stream);
+	Store128(row0 + 16, rows[1], stream);
+	Store128(row1, rows[2], stream);
+	Store128(row1 + 16, rows[3], stream);
+}
+
+// Moves the RGB bytes of 4 RGBA texels to the low 12 bytes and zeroes the top 4
+PLM_TARGET("sse4.1")
+static inline __m128i DropAlphaSSE41(__m128i texels) {
+	return _mm_shuffle_epi8(texels, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+}
+
+// Same 4 pixels as packed RGB, 24 bytes per output row. Rows advance by 24 bytes, so there
+// are no aligned non-temporal stores to be had here.
+PLM_TARGET("sse4.1")
+static inline void StoreTexelsRGBSSE41(const __m128i* acc, uint8_t* row0, uint8_t* row1) {
+	__m128i rows[4];
+	InterleaveTexelsSSE41(acc, rows);
+
+	uint8_t* dest[2] = { row0, row1 };
+	for (int r = 0; r < 2; r++) {
+		__m128i a = DropAlphaSSE41(rows[2 * r]);
+		__m128i b = DropAlphaSSE41(rows[2 * r + 1]);
+		_mm_storeu_si128((__m128i*)dest[r], _mm_or_si128(a, _mm_slli_si128(b, 12)));
+		_mm_storel_epi64((__m128i*)(dest[r] + 16), _mm_srli_si128(b, 4));
+	};
+}
+
+// level = (number of thresholds <= x) % 16
+PLM_TARGET("sse4.1")
+static inline __m128i ThresholdLevelSSE41(__m128 x, const __m128* t) {
+	__m128i count = _mm_setzero_si128();
+	for (int k = 0; k < QUANTISER_LEVELS; k++) {
+		count = _mm_sub_epi32(count, _mm_castps_si128(_mm_cmpge_ps(x, t[k])));
+	};
+	return _mm_and_si128(count, _mm_set1_epi32(QUANTISER_LEVELS - 1));
+}
+
+template <int texel_bytes>
+PLM_TARGET("sse4.1")
+static uint64_t PackRowSSE41(
+	const float* row_phase,
+	uint64_t plane_elements,
+	int num_holograms,
+	const float* thresholds,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t N
+) {
+	__m128 t[QUANTISER_LEVELS];
+	for (int k = 0; k < QUANTISER_LEVELS; k++) t[k] = _mm_set1_ps(thresholds[k]);
+
+	const __m128i nibble_table = _mm_loadu_si128((const __m128i*)tables.nibble);
+	const bool stream = (((uintptr_t)row0 | (uintptr_t)row1) & 15) == 0;
+
+	uint64_t i = 0;
+	for (; i + 4 <= N; i += 4) {
+		__m128i acc[3] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+
+		for (int n = 0; n < num_holograms; n++) {
+			__m128i level = ThresholdLevelSSE41(_mm_loadu_ps(row_phase + i + n * plane_elements), t);
+
+			acc[n / 8] = _mm_or_si128(acc[n / 8], _mm_sll_epi32(LevelBitsSSE41(level, nibble_table), _mm_cvtsi32_si128(n % 8)));
+		};
+
+		if (texel_bytes == 4) {
+			StoreTexelsSSE41(acc, row0 + 8 * i, row1 + 8 * i, stream);
+		} else {
+			StoreTexelsRGBSSE41(acc, row0 + 6 * i, row1 + 6 * i);
+		};
+	};
+
+	return i;
+}
+
+PLM_TARGET("avx2")
+static inline __m256i LevelBitsAVX2(__m256i level, __m256i nibble_table) {
+	__m256i bits = _mm256_and_si256(_mm256_shuffle_epi8(nibble_table, level), _mm256_set1_epi32(0xFF));
+	return _mm256_and_si256(_mm256_mullo_epi32(bits, _mm256_set1_epi32(0x00204081)), _mm256_set1_epi32(0x01010101));
+}
+
+// Same interleave as the SSE4.1 kernel, within each 128-bit lane (pixels 0-3 and 4-7).
+// rows[0] and rows[1] hold pixels 0-3 and 4-7 of output row 2j, rows[2] and rows[3] of row 2j+1.
+PLM_TARGET("avx2")
+static inline void InterleaveTexelsAVX2(const __m256i* acc, __m256i* rows) {
+	const __m256i alpha = _mm256_set1_epi8((char)0xFF);
+	__m256i rg_lo = _mm256_unpacklo_epi8(acc[0], acc[1]);
+	__m256i rg_hi = _mm256_unpackhi_epi8(acc[0], acc[1]);
+	__m256i ba_lo = _mm256_unpacklo_epi8(acc[2], alpha);
+	__m256i ba_hi = _mm256_unpackhi_epi8(acc[2], alpha);
+	__m256i p0 = _mm256_unpacklo_epi16(rg_lo, ba_lo);
+	__m256i p1 = _mm256_unpackhi_epi16(rg_lo, ba_lo);
+	__m256i p2 = _mm256_unpacklo_epi16(rg_hi, ba_hi);
+	__m256i p3 = _mm256_unpackhi_epi16(rg_hi, ba_hi);
+
+	__m256i even_a = _mm256_unpacklo_epi64(p0, p1); // pixels 0, 1 | 4, 5
+	__m256i even_b = _mm256_unpacklo_epi64(p2, p3); // pixels 2, 3 | 6, 7
+	__m256i odd_a = _mm256_unpackhi_epi64(p0, p1);
+	__m256i odd_b = _mm256_unpackhi_epi64(p2, p3);
+
+	rows[0] = _mm256_permute2x128_si256(even_a, even_b, 0x20);
+	rows[1] = _mm256_permute2x128_si256(even_a, even_b, 0x31);
+	rows[2] = _mm256_permute2x128_si256(odd_a, odd_b, 0x20);
+	rows[3] = _mm256_permute2x128_si256(odd_a, odd_b, 0x31);
+}
+
+PLM_TARGET("avx2")
+static inline void StoreTexelsAVX2(const __m256i* acc, uint8_t* row0, uint8_t* row1, bool stream) {
+	__m256i rows[4];
+	InterleaveTexelsAVX2(acc, rows);
+
+	Store256(row0, rows[0], stream);
+	Store256(row0 + 32, rows[1], stream);
+	Store256(row1, rows[2], stream);
+	Store256(row1 + 32, rows[3], stream);
+}
+
+// Same 8 pixels as packed RGB, 48 bytes per output row: the 16 texels of a row are
+// compacted to 12 bytes per 4 and merged into three 16-byte stores, which keep the
+// alignment of the row, so they can be non-temporal.
+PLM_TARGET("avx2")
+static inline void StoreTexelsRGBAVX2(const __m256i* acc, uint8_t* row0, uint8_t* row1, bool stream) {
+	__m256i rows[4];
+	InterleaveTexelsAVX2(acc, rows);
+
+	const __m256i drop_alpha = _mm256_setr_epi8(
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	uint8_t* dest[2] = { row0, row1 };
+	for (int r = 0; r < 2; r++) {
+		__m256i a = _mm256_shuffle_epi8(rows[2 * r], drop_alpha);
+		__m256i b = _mm256_shuffle_epi8(rows[2 * r + 1], drop_alpha);
+		__m128i q0 = _mm256_castsi256_si128(a);
+		__m128i q1 = _mm256_extracti128_si256(a, 1);
+		__m128i q2 = _mm256_castsi256_si128(b);
+		__m128i q3 = _mm256_extracti128_si256(b, 1);
+		Store128(dest[r], _mm_or_si128(q0, _mm_slli_si128(q1, 12)), stream);
+		Store128(dest[r] + 16, _mm_or_si128(_mm_srli_si128(q1, 4), _mm_slli_si128(q2, 8)), stream);
+		Store128(dest[r] + 32, _mm_or_si128(_mm_srli_si128(q2, 8), _mm_slli_si128(q3, 4)), stream);
+	};
+}
+
+PLM_TARGET("avx2")
+static inline __m256i ThresholdLevelAVX2(__m256 x, const __m256* t) {
+	__m256i count = _mm256_setzero_si256();
+	for (int k = 0; k < QUANTISER_LEVELS; k++) {
+		count = _mm256_sub_epi32(count, _mm256_castps_si256(_mm256_cmp_ps(x, t[k], _CMP_GE_OQ)));
+	};
+	return _mm256_and_si256(count, _mm256_set1_epi32(QUANTISER_LEVELS - 1));
+}
+
+template <int texel_bytes>
+PLM_TARGET("avx2")
+static uint64_t PackRowAVX2(
+	const float* row_phase,
+	uint64_t plane_elements,
+	int num_holograms,
+	const float* thresholds,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t N
+) {
+	__m256 t[QUANTISER_LEVELS];
+	for (int k = 0; k < QUANTISER_LEVELS; k++) t[k] = _mm256_set1_ps(thresholds[k]);
+
+	const __m256i nibble_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.nibble));
+	const bool stream = (((uintptr_t)row0 | (uintptr_t)row1) & 15) == 0;
+
+	uint64_t i = 0;
+	for (; i + 8 <= N; i += 8) {
+		__m256i acc[3] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+		for (int n = 0; n < num_holograms; n++) {
+			__m256i level = ThresholdLevelAVX2(_mm256_loadu_ps(row_phase + i + n * plane_elements), t);
+
+			acc[n / 8] = _mm256_or_si256(acc[n / 8], _mm256_sll_epi32(LevelBitsAVX2(level, nibble_table), _mm_cvtsi32_si128(n % 8)));
+		};
+
+		if (texel_bytes == 4) {
+			StoreTexelsAVX2(acc, row0 + 8 * i, row1 + 8 * i, stream);
+		} else {
+			StoreTexelsRGBAVX2(acc, row0 + 6 * i, row1 + 6 * i, stream);
+		};
+	};
+
+	return i;
+}
+
+// Level kernels. Element e of the input is at levels[e] (u8), or in nibble e % 2 of levels[e / 2].
+// Only the bytes holding the elements are read, so the input can end right after the last one.
+template <int count>
+static inline uint32_t LoadNibbles(const uint8_t* levels, uint64_t e) {
+	// count nibbles from element e, element e in the low nibble
+	const uint8_t* p = levels + e / 2;
+	uint32_t w = 0;
+	std::memcpy(&w, p, count / 2);
+	if (e & 1) w = (w >> 4) | (uint32_t)p[count / 2] << (4 * count - 4);
+	return w;
+}
+
+// Levels of elements e to e + 3, higher bits not masked off yet
+template <LevelFormat format>
+PLM_TARGET("sse4.1")
+static inline __m128i LoadLevelsSSE41(const uint8_t* levels, uint64_t e) {
+	if (format == LEVEL_FORMAT_U8) {
+		int32_t bytes;
+		std::memcpy(&bytes, levels + e, 4);
+		return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+	};
+	uint32_t w = LoadNibbles<4>(levels, e);
+	return _mm_setr_epi32(w, w >> 4, w >> 8, w >> 12);
+}
+
+template <LevelFormat format>
+PLM_TARGET("sse4.1")
+static uint64_t PackLevelRowSSE41(
+	const uint8_t* levels,
+	uint64_t row_element,
+	uint64_t plane_elements,
+	int num_holograms,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t N
+) {
+	const __m128i nibble_table = _mm_loadu_si128((const __m128i*)tables.nibble);
+	const __m128i level_mask = _mm_set1_epi32(QUANTISER_LEVELS - 1);
+	const bool stream = (((uintptr_t)row0 | (uintptr_t)row1) & 15) == 0;
+
+	uint64_t i = 0;
+	for (; i + 4 <= N; i += 4) {
+		__m128i acc[3] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+
+		for (int n = 0; n < num_holograms; n++) {
+			__m128i level = _mm_and_si128(LoadLevelsSSE41<format>(levels, row_element + i + n * plane_elements), level_mask);
+
+			acc[n / 8] = _mm_or_si128(acc[n / 8], _mm_sll_epi32(LevelBitsSSE41(level, nibble_table), _mm_cvtsi32_si128(n % 8)));
+		};
+
+		StoreTexelsSSE41(acc, row0 + 8 * i, row1 + 8 * i, stream);
+	};
+
+	return i;
+}
+
+template <LevelFormat format>
+PLM_TARGET("avx2")
+static uint64_t PackLevelRowAVX2(
+	const uint8_t* levels,
+	uint64_t row_element,
+	uint64_t plane_elements,
+	int num_holograms,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t N
+) {
+	const __m256i nibble_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.nibble));
+	const __m256i level_mask = _mm256_set1_epi32(QUANTISER_LEVELS - 1);
+	const __m256i nibble_shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+	const bool stream = (((uintptr_t)row0 | (uintptr_t)row1) & 15) == 0;
+
+	uint64_t i = 0;
+	for (; i + 8 <= N; i += 8) {
+		__m256i acc[3] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+		for (int n = 0; n < num_holograms; n++) {
+			const uint64_t e = row_element + i + n * plane_elements;
+			__m256i level;
+			if (format == LEVEL_FORMAT_U8) {
+				level = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(levels + e)));
+			} else {
+				level = _mm256_srlv_epi32(_mm256_set1_epi32((int)LoadNibbles<8>(levels, e)), nibble_shifts);
+			};
+			level = _mm256_and_si256(level, level_mask);
+
+			acc[n / 8] = _mm256_or_si256(acc[n / 8], _mm256_sll_epi32(LevelBitsAVX2(level, nibble_table), _mm_cvtsi32_si128(n % 8)));
+		};
+
+		StoreTexelsAVX2(acc, row0 + 8 * i, row1 + 8 * i, stream);
+	};
+
+	return i;
+}
+
+// Fixed-point kernels, levels looked up in the quantiser's table for the phase type
+template <typename T>
+PLM_TARGET("sse4.1")
+static uint64_t PackFixedPointRowSSE41(
+	const T* row_phase,
+	uint64_t plane_elements,
+	int num_holograms,
+	const uint8_t* levels,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t N
+) {
+	const __m128i nibble_table = _mm_loadu_si128((const __m128i*)tables.nibble);
+	const bool stream = (((uintptr_t)row0 | (uintptr_t)row1) & 15) == 0;
+
+	uint64_t i = 0;
+	for (; i + 4 <= N; i += 4) {
+		__m128i acc[3] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+
+		for (int n = 0; n < num_holograms; n++) {
+			// No gather before AVX2, four scalar lookups
+			const T* p = row_phase + i + n * plane_elements;
+			__m128i level = _mm_setr_epi32(levels[p[0]], levels[p[1]], levels[p[2]], levels[p[3]]);
+
+			acc[n / 8] = _mm_or_si128(acc[n / 8], _mm_sll_epi32(LevelBitsSSE41(level, nibble_table), _mm_cvtsi32_si128(n % 8)));
+		};
+
+		StoreTexelsSSE41(acc, row0 + 8 * i, row1 + 8 * i, stream);
+	};
+
+	return i;
+}
+
+template <typename T>
+PLM_TARGET("avx2")
+static uint64_t PackFixedPointRowAVX2(
+	const T* row_phase,
+	uint64_t plane_elements,
+	int num_holograms,
+	const uint8_t* levels,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t N
+) {
+	const __m256i nibble_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.nibble));
+	const __m256i level_mask = _mm256_set1_epi32(QUANTISER_LEVELS - 1);
+	const bool stream = (((uintptr_t)row0 | (uintptr_t)row1) & 15) == 0;
+
+	uint64_t i = 0;
+	for (; i + 8 <= N; i += 8) {
+		__m256i acc[3] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+		for (int n = 0; n < num_holograms; n++) {
+			const T* p = row_phase + i + n * plane_elements;
+			__m256i v = sizeof(T) == 1
+				? _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p))
+				: _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+
+			// 32-bit gather at byte offsets, the level is the low byte (the table is padded for it)
+			__m256i level = _mm256_and_si256(_mm256_i32gather_epi32((const int*)levels, v, 1), level_mask);
+
+			acc[n / 8] = _mm256_or_si256(acc[n / 8], _mm256_sll_epi32(LevelBitsAVX2(level, nibble_table), _mm_cvtsi32_si128(n % 8)));
+		};
+
+		StoreTexelsAVX2(acc, row0 + 8 * i, row1 + 8 * i, stream);
+	};
+
+	return i;
+}
+
+// Strided kernels. The phases of 4 or 8 consecutive pixels are loaded straight when the
+// pixels are contiguous and gathered otherwise, then rounded to float and quantised like
+// the float kernels. They pack pixels [i_begin, i_end) and return where they stopped.
+PLM_TARGET("sse4.1")
+static inline __m128 LoadPhasesSSE41(const float* p, int64_t stride) {
+	if (stride == 1) return _mm_loadu_ps(p);
+	return _mm_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride]);
+}
+
+PLM_TARGET("sse4.1")
+static inline __m128 LoadPhasesSSE41(const double* p, int64_t stride) {
+	if (stride == 1) return _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(p)), _mm_cvtpd_ps(_mm_loadu_pd(p + 2)));
+	return _mm_setr_ps((float)p[0], (float)p[stride], (float)p[2 * stride], (float)p[3 * stride]);
+}
+
+PLM_TARGET("avx2")
+static inline __m256 LoadPhasesAVX2(const float* p, int64_t stride, __m256i offsets) {
+	if (stride == 1) return _mm256_loadu_ps(p);
+	return _mm256_set_m128(_mm256_i64gather_ps(p + 4 * stride, offsets, 4), _mm256_i64gather_ps(p, offsets, 4));
+}
+
+PLM_TARGET("avx2")
+static inline __m256 LoadPhasesAVX2(const double* p, int64_t stride, __m256i offsets) {
+	__m256d lo, hi;
+	if (stride == 1) {
+		lo = _mm256_loadu_pd(p);
+		hi = _mm256_loadu_pd(p + 4);
+	} else {
+		lo = _mm256_i64gather_pd(p, offsets, 8);
+		hi = _mm256_i64gather_pd(p + 4 * stride, offsets, 8);
+	};
+	return _mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo));
+}
+
+template <typename T>
+PLM_TARGET("sse4.1")
+static uint64_t PackStridedRowSSE41(
+	const T* row_phase,
+	const PhaseLayout& layout,
+	int num_holograms,
+	const float* thresholds,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t i_begin,
+	uint64_t i_end
+) {
+	__m128 t[QUANTISER_LEVELS];
+	for (int k = 0; k < QUANTISER_LEVELS; k++) t[k] = _mm_set1_ps(thresholds[k]);
+
+	const __m128i nibble_table = _mm_loadu_si128((const __m128i*)tables.nibble);
+	const bool stream = (((uintptr_t)(row0 + 8 * i_begin) | (uintptr_t)(row1 + 8 * i_begin)) & 15) == 0;
+
+	uint64_t i = i_begin;
+	for (; i + 4 <= i_end; i += 4) {
+		const T* pixel = row_phase + (int64_t)i * layout.pixel_stride;
+		__m128i acc[3] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+
+		for (int n = 0; n < num_holograms; n++) {
+			__m128i level = ThresholdLevelSSE41(LoadPhasesSSE41(pixel + n * layout.plane_stride, layout.pixel_stride), t);
+
+			acc[n / 8] = _mm_or_si128(acc[n / 8], _mm_sll_epi32(LevelBitsSSE41(level, nibble_table), _mm_cvtsi32_si128(n % 8)));
+		};
+
+		StoreTexelsSSE41(acc, row0 + 8 * i, row1 + 8 * i, stream);
+	};
+
+	return i;
+}
+
+template <typename T>
+PLM_TARGET("avx2")
+static uint64_t PackStridedRowAVX2(
+	const T* row_phase,
+	const PhaseLayout& layout,
+	int num_holograms,
+	const float* thresholds,
+	const BitpackTables& tables,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t i_begin,
+	uint64_t i_end
+) {
+	__m256 t[QUANTISER_LEVELS];
+	for (int k = 0; k < QUANTISER_LEVELS; k++) t[k] = _mm256_set1_ps(thresholds[k]);
+
+	const __m256i nibble_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables.nibble));
+	const __m256i offsets = _mm256_setr_epi64x(0, layout.pixel_stride, 2 * layout.pixel_stride, 3 * layout.pixel_stride);
+	const bool stream = (((uintptr_t)(row0 + 8 * i_begin) | (uintptr_t)(row1 + 8 * i_begin)) & 15) == 0;
+
+	uint64_t i = i_begin;
+	for (; i + 8 <= i_end; i += 8) {
+		const T* pixel = row_phase + (int64_t)i * layout.pixel_stride;
+		__m256i acc[3] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+		for (int n = 0; n < num_holograms; n++) {
+			__m256i level = ThresholdLevelAVX2(LoadPhasesAVX2(pixel + n * layout.plane_stride, layout.pixel_stride, offsets), t);
+
+			acc[n / 8] = _mm256_or_si256(acc[n / 8], _mm256_sll_epi32(LevelBitsAVX2(level, nibble_table), _mm_cvtsi32_si128(n % 8)));
+		};
+
+		StoreTexelsAVX2(acc, row0 + 8 * i, row1 + 8 * i, stream);
+	};
+
+	return i;
+}
+#endif
+
+// Vectorised packing of rows [row_begin, row_end) into RGBA (texel_bytes 4) or packed RGB
+// (texel_bytes 3) output rows that are pitch bytes apart
+template <int texel_bytes>
+static bool PackRowsSIMD(
+	const float* phase,
+	uint8_t* out,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+#ifdef PLM_X86
+	// The vector quantiser counts thresholds, which is only exact for a monotonic lookup-table
+	if (isa == BITPACK_ISA_SCALAR || isa > DetectBitpackISA() || !quantiser.IsMonotonic()) return false;
+	if (num_holograms > 24) return false;
+
+	BitpackTables tables;
+	BuildBitpackTables(phase_map, tables);
+
+	const uint64_t plane_elements = N * M;
+
+	for (uint64_t j = row_begin; j < row_end; j++) {
+		const float* row_phase = phase + j * N;
+		uint8_t* row0 = out + (2 * j + 0) * pitch;
+		uint8_t* row1 = out + (2 * j + 1) * pitch;
+
+		uint64_t done = isa == BITPACK_ISA_AVX2
+			? PackRowAVX2<texel_bytes>(row_phase, plane_elements, num_holograms, quantiser.Thresholds(), tables, row0, row1, N)
+			: PackRowSSE41<texel_bytes>(row_phase, plane_elements, num_holograms, quantiser.Thresholds(), tables, row0, row1, N);
+
+		PackRowScalar<float, texel_bytes>(row_phase, plane_elements, num_holograms, quantiser, tables, row0, row1, done, N);
+	};
+
+	// Make the non-temporal stores visible before anyone reads the frame
+	_mm_sfence();
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool BitpackHologramsSIMD(
+	const float* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+	return PackRowsSIMD<4>(phase, hologram, 4 * 2 * N, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+}
+
+void BitpackHologramRows(
+	const float* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+	if (BitpackHologramsSIMD(phase, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa)) return;
+
+	// Same pixel-major walk, one pixel at a time
+	BitpackTables tables;
+	BuildBitpackTables(phase_map, tables);
+
+	const uint64_t row_bytes = 4 * 2 * N;
+	for (uint64_t j = row_begin; j < row_end; j++) {
+		PackRowScalar(phase + j * N, N * M, num_holograms, quantiser, tables,
+			hologram + (2 * j + 0) * row_bytes, hologram + (2 * j + 1) * row_bytes, 0, N);
+	};
+}
+
+void BitpackHologramsParallel(
+	ThreadPool& pool,
+	const float* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa
+) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		BitpackHologramRows(phase, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+	});
+}
+
+void BitpackHologramRowsRGB(
+	const float* phase,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+	if (PackRowsSIMD<3>(phase, rgb, pitch, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa)) return;
+
+	BitpackTables tables;
+	BuildBitpackTables(phase_map, tables);
+
+	for (uint64_t j = row_begin; j < row_end; j++) {
+		PackRowScalar<float, 3>(phase + j * N, N * M, num_holograms, quantiser, tables,
+			rgb + (2 * j + 0) * pitch, rgb + (2 * j + 1) * pitch, 0, N);
+	};
+}
+
+void BitpackHologramsRGBParallel(
+	ThreadPool& pool,
+	const float* phase,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa
+) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		BitpackHologramRowsRGB(phase, rgb, pitch, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+	});
+}
+
+PhaseLayout MakePhaseLayout(PhaseOrder order, uint64_t N, uint64_t M, uint64_t plane_stride) {
+	const int64_t plane = plane_stride ? (int64_t)plane_stride : (int64_t)(N * M);
+	if (order == PHASE_COLUMN_MAJOR) return { (int64_t)M, 1, plane };
+	return { 1, (int64_t)N, plane };
+}
+
+// Pixels walked along a row before moving to the next one, when the rows are closer in memory
+// than the pixels (column-major). Tiles of STRIDED_TILE_ROWS rows then share the cache lines
+// of each column instead of fetching a new one for every pixel.
+constexpr uint64_t STRIDED_TILE_PIXELS = 16;
+constexpr uint64_t STRIDED_TILE_ROWS = 32;
+
+template <typename T>
+static void PackStridedRows(
+	const T* phase,
+	const PhaseLayout& layout,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+	if (num_holograms > 24) return;
+	// Rows past the holograms would be read through the strides from outside the input
+	row_end = std::min(row_end, M);
+	if (isa > DetectBitpackISA()) isa = DetectBitpackISA();
+	// The vector quantiser counts thresholds, which is only exact for a monotonic lookup-table
+	if (!quantiser.IsMonotonic()) isa = BITPACK_ISA_SCALAR;
+
+	BitpackTables tables;
+	BuildBitpackTables(phase_map, tables);
+
+	const bool tiled = std::llabs(layout.row_stride) < std::llabs(layout.pixel_stride);
+	const uint64_t tile_pixels = tiled ? STRIDED_TILE_PIXELS : N;
+	const uint64_t tile_rows = tiled ? STRIDED_TILE_ROWS : 1;
+	const uint64_t row_bytes = 4 * 2 * N;
+
+	for (uint64_t j_begin = row_begin; j_begin < row_end; j_begin += tile_rows) {
+		const uint64_t j_end = std::min(j_begin + tile_rows, row_end);
+		for (uint64_t i_begin = 0; i_begin < N; i_begin += tile_pixels) {
+			const uint64_t i_end = std::min(i_begin + tile_pixels, N);
+			for (uint64_t j = j_begin; j < j_end; j++) {
+				const T* row_phase = phase + (int64_t)j * layout.row_stride;
+				uint8_t* row0 = hologram + (2 * j + 0) * row_bytes;
+				uint8_t* row1 = hologram + (2 * j + 1) * row_bytes;
+				uint64_t done = i_begin;
+#ifdef PLM_X86
+				if (isa == BITPACK_ISA_AVX2) done = PackStridedRowAVX2(row_phase, layout, num_holograms, quantiser.Thresholds(), tables, row0, row1, i_begin, i_end);
+				else if (isa == BITPACK_ISA_SSE41) done = PackStridedRowSSE41(row_phase, layout, num_holograms, quantiser.Thresholds(), tables, row0, row1, i_begin, i_end);
+#endif
+				PackStridedRowScalar(row_phase, layout, num_holograms, quantiser, tables, row0, row1, done, i_end);
+			};
+		};
+	};
+
+#ifdef PLM_X86
+	if (isa != BITPACK_ISA_SCALAR) _mm_sfence();
+#endif
+}
+
+void PhaseLayoutExtent(const PhaseLayout& layout, uint64_t N, uint64_t M, int num_holograms, int64_t& first, int64_t& last) {
+	first = 0;
+	last = 0;
+	const int64_t steps[3] = { (int64_t)N - 1, (int64_t)M - 1, (int64_t)num_holograms - 1 };
+	const int64_t strides[3] = { layout.pixel_stride, layout.row_stride, layout.plane_stride };
+	for (int axis = 0; axis < 3; axis++) {
+		if (strides[axis] < 0) first += steps[axis] * strides[axis];
+		else last += steps[axis] * strides[axis];
+	};
+}
+
+void BitpackHologramRows(const float* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N, uint64_t M,
+	int num_holograms, const PhaseQuantiser& quantiser, const int* phase_map, uint64_t row_begin, uint64_t row_end, BitpackISA isa) {
+	PackStridedRows(phase, layout, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+}
+
+void BitpackHologramsParallel(ThreadPool& pool, const float* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N,
+	uint64_t M, int num_holograms, const PhaseQuantiser& quantiser, const int* phase_map, BitpackISA isa) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		PackStridedRows(phase, layout, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+	});
+}
+
+void BitpackHologramRows(const double* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N, uint64_t M,
+	int num_holograms, const PhaseQuantiser& quantiser, const int* phase_map, uint64_t row_begin, uint64_t row_end, BitpackISA isa) {
+	PackStridedRows(phase, layout, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+}
+
+void BitpackHologramsParallel(ThreadPool& pool, const double* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N,
+	uint64_t M, int num_holograms, const PhaseQuantiser& quantiser, const int* phase_map, BitpackISA isa) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		PackStridedRows(phase, layout, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+	});
+}
+
+template <typename T>
+static void GatherPhaseRows(const T* phase, const PhaseLayout& layout, float* dest, uint64_t N, uint64_t M, int num_holograms) {
+	// Walk the source in memory order, the destination has to take the strided writes
+	const bool columns_first = std::llabs(layout.row_stride) < std::llabs(layout.pixel_stride);
+	for (int n = 0; n < num_holograms; n++) {
+		const T* plane = phase + n * layout.plane_stride;
+		float* dest_plane = dest + n * N * M;
+		if (columns_first) {
+			for (uint64_t i = 0; i < N; i++) {
+				const T* column = plane + (int64_t)i * layout.pixel_stride;
+				for (uint64_t j = 0; j < M; j++) dest_plane[i + j * N] = (float)column[(int64_t)j * layout.row_stride];
+			};
+		} else {
+			for (uint64_t j = 0; j < M; j++) {
+				const T* row = plane + (int64_t)j * layout.row_stride;
+				for (uint64_t i = 0; i < N; i++) dest_plane[i + j * N] = (float)row[(int64_t)i * layout.pixel_stride];
+			};
+		};
+	};
+}
+
+void GatherPhases(const float* phase, const PhaseLayout& layout, float* dest, uint64_t N, uint64_t M, int num_holograms) {
+	GatherPhaseRows(phase, layout, dest, N, M, num_holograms);
+}
+
+void GatherPhases(const double* phase, const PhaseLayout& layout, float* dest, uint64_t N, uint64_t M, int num_holograms) {
+	GatherPhaseRows(phase, layout, dest, N, M, num_holograms);
+}
+
+uint64_t LevelBytes(LevelFormat format, uint64_t elements) {
+	return format == LEVEL_FORMAT_NIBBLE ? (elements + 1) / 2 : elements;
+}
+
+void BitpackLevelRows(
+	const uint8_t* levels,
+	LevelFormat format,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+	if (num_holograms > 24) return;
+	if (isa > DetectBitpackISA()) isa = DetectBitpackISA();
+
+	BitpackTables tables;
+	BuildBitpackTables(phase_map, tables);
+
+	const uint64_t plane_elements = N * M;
+	const uint64_t row_bytes = 4 * 2 * N;
+
+	for (uint64_t j = row_begin; j < row_end; j++) {
+		uint8_t* row0 = hologram + (2 * j + 0) * row_bytes;
+		uint8_t* row1 = hologram + (2 * j + 1) * row_bytes;
+		uint64_t done = 0;
+#ifdef PLM_X86
+		if (format == LEVEL_FORMAT_U8) {
+			if (isa == BITPACK_ISA_AVX2) done = PackLevelRowAVX2<LEVEL_FORMAT_U8>(levels, j * N, plane_elements, num_holograms, tables, row0, row1, N);
+			else if (isa == BITPACK_ISA_SSE41) done = PackLevelRowSSE41<LEVEL_FORMAT_U8>(levels, j * N, plane_elements, num_holograms, tables, row0, row1, N);
+		} else {
+			if (isa == BITPACK_ISA_AVX2) done = PackLevelRowAVX2<LEVEL_FORMAT_NIBBLE>(levels, j * N, plane_elements, num_holograms, tables, row0, row1, N);
+			else if (isa == BITPACK_ISA_SSE41) done = PackLevelRowSSE41<LEVEL_FORMAT_NIBBLE>(levels, j * N, plane_elements, num_holograms, tables, row0, row1, N);
+		};
+#endif
+		PackLevelRowScalar(levels, format, j * N, plane_elements, num_holograms, tables, row0, row1, done, N);
+	};
+
+#ifdef PLM_X86
+	// Make the non-temporal stores visible before anyone reads the frame
+	if (isa != BITPACK_ISA_SCALAR) _mm_sfence();
+#endif
+}
+
+void BitpackLevelsParallel(
+	ThreadPool& pool,
+	const uint8_t* levels,
+	LevelFormat format,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const int* phase_map,
+	BitpackISA isa
+) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		BitpackLevelRows(levels, format, hologram, N, M, num_holograms, phase_map, row_begin, row_end, isa);
+	});
+}
+
+// Fixed-point phases. Every kernel reads the level tables, so any lookup-table works.
+template <typename T>
+static void PackFixedPointRows(
+	const T* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+	if (num_holograms > 24) return;
+	if (isa > DetectBitpackISA()) isa = DetectBitpackISA();
+
+	BitpackTables tables;
+	BuildBitpackTables(phase_map, tables);
+
+	const uint8_t* levels = sizeof(T) == 1 ? quantiser.LevelsU8() : quantiser.LevelsU16();
+	const uint64_t plane_elements = N * M;
+	const uint64_t row_bytes = 4 * 2 * N;
+
+	for (uint64_t j = row_begin; j < row_end; j++) {
+		const T* row_phase = phase + j * N;
+		uint8_t* row0 = hologram + (2 * j + 0) * row_bytes;
+		uint8_t* row1 = hologram + (2 * j + 1) * row_bytes;
+		uint64_t done = 0;
+#ifdef PLM_X86
+		if (isa == BITPACK_ISA_AVX2) done = PackFixedPointRowAVX2(row_phase, plane_elements, num_holograms, levels, tables, row0, row1, N);
+		else if (isa == BITPACK_ISA_SSE41) done = PackFixedPointRowSSE41(row_phase, plane_elements, num_holograms, levels, tables, row0, row1, N);
+#endif
+		PackRowScalar(row_phase, plane_elements, num_holograms, quantiser, tables, row0, row1, done, N);
+	};
+
+#ifdef PLM_X86
+	if (isa != BITPACK_ISA_SCALAR) _mm_sfence();
+#endif
+}
+
+void BitpackHologramRows(const uint8_t* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms,
+	const PhaseQuantiser& quantiser, const int* phase_map, uint64_t row_begin, uint64_t row_end, BitpackISA isa) {
+	PackFixedPointRows(phase, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+}
+
+void BitpackHologramRows(const uint16_t* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms,
+	const PhaseQuantiser& quantiser, const int* phase_map, uint64_t row_begin, uint64_t row_end, BitpackISA isa) {
+	PackFixedPointRows(phase, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+}
+
+void BitpackHologramsParallel(ThreadPool& pool, const uint8_t* phase, uint8_t* hologram, uint64_t N, uint64_t M,
+	int num_holograms, const PhaseQuantiser& quantiser, const int* phase_map, BitpackISA isa) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		PackFixedPointRows(phase, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+	});
+}
+
+void BitpackHologramsParallel(ThreadPool& pool, const uint16_t* phase, uint8_t* hologram, uint64_t N, uint64_t M,
+	int num_holograms, const PhaseQuantiser& quantiser, const int* phase_map, BitpackISA isa) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		PackFixedPointRows(phase, hologram, N, M, num_holograms, quantiser, phase_map, row_begin, row_end, isa);
+	});
+}
+
+// Plane updates. Only bit plane % 8 of colour channel plane / 8 changes: each byte of that
+// channel is read, masked and written back, the other channels are left alone. Pixel i of
+// phase row j owns bytes 6i + channel and 6i + 3 + channel of RGB rows 2j and 2j + 1.
+template <typename LevelAt>
+static void PackPlaneRowScalar(
+	LevelAt level_at,
+	const BitpackTables& tables,
+	int plane,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t i_begin,
+	uint64_t i_end
+) {
+	const int bit = plane % 8;
+	const uint8_t keep = (uint8_t)~(1u << bit);
+	for (uint64_t i = i_begin; i < i_end; i++) {
+		const uint32_t spread = tables.spread[level_at(i)];
+		uint8_t* t0 = row0 + 6 * i + plane / 8;
+		uint8_t* t1 = row1 + 6 * i + plane / 8;
+		t0[0] = (uint8_t)((t0[0] & keep) | ((spread >> 0) & 1) << bit);
+		t0[3] = (uint8_t)((t0[3] & keep) | ((spread >> 8) & 1) << bit);
+		t1[0] = (uint8_t)((t1[0] & keep) | ((spread >> 16) & 1) << bit);
+		t1[3] = (uint8_t)((t1[3] & keep) | ((spread >> 24) & 1) << bit);
+	};
+}
+
+#ifdef PLM_X86
+// The vector kernels do 8 pixels, i.e. 16 texels or 48 bytes of each RGB row, at a time. The
+// texel bits are spread to the channel's bytes of the three 16-byte blocks with a shuffle each.
+// The read-modify-write is bound by memory rather than by the quantiser, so AVX2 machines run
+// these too.
+struct PlaneMasks {
+	__m128i spread[3];   // Texel t to the channel byte of t within each block, zero elsewhere
+	__m128i clear[3];    // The bit of the plane in each channel byte
+	__m128i bit;
+};
+
+PLM_TARGET("sse4.1")
+static void BuildPlaneMasks(int plane, PlaneMasks& masks) {
+	for (int block = 0; block < 3; block++) {
+		alignas(16) uint8_t spread[16];
+		for (int b = 0; b < 16; b++) {
+			const int byte = 16 * block + b;
+			spread[b] = byte % 3 == plane / 8 ? (uint8_t)(byte / 3) : 0x80;
+		};
+		masks.spread[block] = _mm_load_si128((const __m128i*)spread);
+	};
+	masks.bit = _mm_set1_epi8((char)(1 << (plane % 8)));
+	for (int block = 0; block < 3; block++) masks.clear[block] = _mm_shuffle_epi8(masks.bit, masks.spread[block]);
+}
+
+// bits_lo and bits_hi hold the phase map bits of pixels 0-3 and 4-7, as from LevelBitsSSE41
+PLM_TARGET("sse4.1")
+static inline void StorePlaneSSE41(__m128i bits_lo, __m128i bits_hi, const PlaneMasks& masks, uint8_t* row0, uint8_t* row1) {
+	const __m128i even = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i odd = _mm_setr_epi8(2, 3, 6, 7, 10, 11, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i zero = _mm_setzero_si128();
+
+	// One byte per texel, 0 or the plane's bit
+	__m128i texels[2] = {
+		_mm_unpacklo_epi64(_mm_shuffle_epi8(bits_lo, even), _mm_shuffle_epi8(bits_hi, even)),
+		_mm_unpacklo_epi64(_mm_shuffle_epi8(bits_lo, odd), _mm_shuffle_epi8(bits_hi, odd)),
+	};
+	uint8_t* rows[2] = { row0, row1 };
+	for (int r = 0; r < 2; r++) {
+		__m128i bits = _mm_and_si128(_mm_sub_epi8(zero, texels[r]), masks.bit);
+		for (int block = 0; block < 3; block++) {
+			__m128i* dest = (__m128i*)(rows[r] + 16 * block);
+			__m128i old = _mm_andnot_si128(masks.clear[block], _mm_loadu_si128(dest));
+			_mm_storeu_si128(dest, _mm_or_si128(old, _mm_shuffle_epi8(bits, masks.spread[block])));
+		};
+	};
+}
+
+PLM_TARGET("sse4.1")
+static uint64_t PackPlaneRowSSE41(
+	const float* row_phase,
+	const float* thresholds,
+	const BitpackTables& tables,
+	int plane,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t N
+) {
+	__m128 t[QUANTISER_LEVELS];
+	for (int k = 0; k < QUANTISER_LEVELS; k++) t[k] = _mm_set1_ps(thresholds[k]);
+
+	const __m128i nibble_table = _mm_loadu_si128((const __m128i*)tables.nibble);
+	PlaneMasks masks;
+	BuildPlaneMasks(plane, masks);
+
+	uint64_t i = 0;
+	for (; i + 8 <= N; i += 8) {
+		__m128i lo = LevelBitsSSE41(ThresholdLevelSSE41(_mm_loadu_ps(row_phase + i), t), nibble_table);
+		__m128i hi = LevelBitsSSE41(ThresholdLevelSSE41(_mm_loadu_ps(row_phase + i + 4), t), nibble_table);
+		StorePlaneSSE41(lo, hi, masks, row0 + 6 * i, row1 + 6 * i);
+	};
+
+	return i;
+}
+
+template <LevelFormat format>
+PLM_TARGET("sse4.1")
+static uint64_t PackLevelPlaneRowSSE41(
+	const uint8_t* levels,
+	uint64_t row_element,
+	const BitpackTables& tables,
+	int plane,
+	uint8_t* row0,
+	uint8_t* row1,
+	uint64_t N
+) {
+	const __m128i nibble_table = _mm_loadu_si128((const __m128i*)tables.nibble);
+	const __m128i level_mask = _mm_set1_epi32(QUANTISER_LEVELS - 1);
+	PlaneMasks masks;
+	BuildPlaneMasks(plane, masks);
+
+	uint64_t i = 0;
+	for (; i + 8 <= N; i += 8) {
+		__m128i lo = _mm_and_si128(LoadLevelsSSE41<format>(levels, row_element + i), level_mask);
+		__m128i hi = _mm_and_si128(LoadLevelsSSE41<format>(levels, row_element + i + 4), level_mask);
+		StorePlaneSSE41(LevelBitsSSE41(lo, nibble_table), LevelBitsSSE41(hi, nibble_table), masks, row0 + 6 * i, row1 + 6 * i);
+	};
+
+	return i;
+}
+#endif
+
+void BitpackPlaneRows(
+	const float* phase,
+	int plane,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+	if (plane < 0 || plane >= 24) return;
+	row_end = std::min(row_end, M);
+	if (isa > DetectBitpackISA()) isa = DetectBitpackISA();
+	// The vector quantiser counts thresholds, which is only exact for a monotonic lookup-table
+	if (!quantiser.IsMonotonic()) isa = BITPACK_ISA_SCALAR;
+
+	BitpackTables tables;
+	BuildBitpackTables(phase_map, tables);
+
+	for (uint64_t j = row_begin; j < row_end; j++) {
+		const float* row_phase = phase + j * N;
+		uint8_t* row0 = rgb + (2 * j + 0) * pitch;
+		uint8_t* row1 = rgb + (2 * j + 1) * pitch;
+		uint64_t done = 0;
+#ifdef PLM_X86
+		if (isa != BITPACK_ISA_SCALAR) done = PackPlaneRowSSE41(row_phase, quantiser.Thresholds(), tables, plane, row0, row1, N);
+#endif
+		PackPlaneRowScalar([&](uint64_t i) { return quantiser(row_phase[i]); }, tables, plane, row0, row1, done, N);
+	};
+}
+
+void BitpackLevelPlaneRows(
+	const uint8_t* levels,
+	LevelFormat format,
+	int plane,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa
+) {
+	if (plane < 0 || plane >= 24) return;
+	row_end = std::min(row_end, M);
+	if (isa > DetectBitpackISA()) isa = DetectBitpackISA();
+
+	BitpackTables tables;
+	BuildBitpackTables(phase_map, tables);
+
+	for (uint64_t j = row_begin; j < row_end; j++) {
+		uint8_t* row0 = rgb + (2 * j + 0) * pitch;
+		uint8_t* row1 = rgb + (2 * j + 1) * pitch;
+		uint64_t done = 0;
+#ifdef PLM_X86
+		if (isa != BITPACK_ISA_SCALAR) {
+			done = format == LEVEL_FORMAT_U8
+				? PackLevelPlaneRowSSE41<LEVEL_FORMAT_U8>(levels, j * N, tables, plane, row0, row1, N)
+				: PackLevelPlaneRowSSE41<LEVEL_FORMAT_NIBBLE>(levels, j * N, tables, plane, row0, row1, N);
+		};
+#endif
+		PackPlaneRowScalar([&](uint64_t i) { return Level(levels, format, j * N + i); }, tables, plane, row0, row1, done, N);
+	};
+}
+
+void BitpackPlaneParallel(ThreadPool& pool, const float* phase, int plane, uint8_t* rgb, uint64_t pitch, uint64_t N, uint64_t M,
+	const PhaseQuantiser& quantiser, const int* phase_map, BitpackISA isa) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		BitpackPlaneRows(phase, plane, rgb, pitch, N, M, quantiser, phase_map, row_begin, row_end, isa);
+	});
+}
+
+void BitpackLevelPlaneParallel(ThreadPool& pool, const uint8_t* levels, LevelFormat format, int plane, uint8_t* rgb, uint64_t pitch,
+	uint64_t N, uint64_t M, const int* phase_map, BitpackISA isa) {
+	pool.ParallelFor(M, [&](uint64_t row_begin, uint64_t row_end) {
+		BitpackLevelPlaneRows(levels, format, plane, rgb, pitch, N, M, phase_map, row_begin, row_end, isa);
+	});
+}
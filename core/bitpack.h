@@ -0,0 +1,328 @@
+#pragma once
+
+#include <cstdint>
+
+#include "quantiser.h"
+#include "thread_pool.h"
+
+// CPU bitpacking kernels.
+//
+// Every phase pixel (i, j) of hologram n is quantised to a level, and the four bits
+// phase_map[level * 4 + k] go to bit n % 8 of colour channel n / 8 in the 2x2 block
+// of output texels:
+//   k = 0 -> (2i, 2j+1), k = 1 -> (2i, 2j), k = 2 -> (2i+1, 2j+1), k = 3 -> (2i+1, 2j)
+// The output frame is 2N x 2M RGBA with alpha set to 255.
+//
+// All kernels work on a range of phase rows [row_begin, row_end), i.e. output rows
+// [2 * row_begin, 2 * row_end), so a frame can be split between threads.
+//
+// Apart from the reference kernel, they are pixel-major: the holograms of a pixel are
+// gathered from the N x M x num_holograms input, its 4 texels are built in registers and
+// written exactly once. The output buffer doesn't need to be zeroed beforehand.
+
+// Pre-quantised input, levels 0-15 ordered like the phases (element i + j * N + n * N * M).
+// U8 holds one level per byte, NIBBLE two: element e in the low nibble of byte e / 2 if e is
+// even, in the high nibble if it's odd. Higher bits of a u8 level are ignored.
+enum LevelFormat {
+	LEVEL_FORMAT_U8 = 0,
+	LEVEL_FORMAT_NIBBLE = 1,
+};
+
+// Instruction sets the kernels can run on, from worst to best
+enum BitpackISA {
+	BITPACK_ISA_SCALAR = 0,
+	BITPACK_ISA_SSE41 = 1,
+	BITPACK_ISA_AVX2 = 2,
+};
+
+// Best instruction set supported by this CPU and OS (queried once through CPUID)
+BitpackISA DetectBitpackISA();
+const char* BitpackISAName(BitpackISA isa);
+
+// Reference kernel, hologram by hologram. ORs the bits into hologram, which has to be zeroed.
+void BitpackHologramsScalar(
+	const float* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end);
+
+// Vectorised kernel. Quantises 4 (SSE4.1) or 8 (AVX2) pixels at once over all holograms.
+// Uses non-temporal stores when the output rows are 16-byte aligned.
+// Returns false if isa is not supported or the lookup-table is not monotonic.
+bool BitpackHologramsSIMD(
+	const float* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa);
+
+// Runs the best kernel available for isa, falling back to a scalar pixel-major loop.
+void BitpackHologramRows(
+	const float* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+// Splits the phase rows of a frame between the threads of pool and packs them with BitpackHologramRows.
+void BitpackHologramsParallel(
+	ThreadPool& pool,
+	const float* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
+
+// Packs straight into packed RGB rows (3 bytes per texel, see FrameStore), pitch bytes apart,
+// e.g. a frame-store slot. No RGBA frame is built on the way, so every byte is written once.
+void BitpackHologramRowsRGB(
+	const float* phase,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackHologramsRGBParallel(
+	ThreadPool& pool,
+	const float* phase,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
+
+// Fixed-point phases, uint8 v standing for v / 255 and uint16 v for v / 65535, quantised
+// through the quantiser's level tables. The tables work for any lookup-table, monotonic or not.
+void BitpackHologramRows(
+	const uint8_t* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackHologramRows(
+	const uint16_t* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackHologramsParallel(
+	ThreadPool& pool,
+	const uint8_t* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackHologramsParallel(
+	ThreadPool& pool,
+	const uint16_t* phase,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
+
+// Where phase element (i, j, n) is stored, in elements:
+//   phase[i * pixel_stride + j * row_stride + n * plane_stride]
+// Row-major is the layout used everywhere else (pixel_stride 1, row_stride N). Column-major
+// is how MATLAB stores an M x N x num_holograms array (pixel_stride M, row_stride 1).
+// Any other strides work too, negative ones included, e.g. for a sliced or transposed NumPy view.
+struct PhaseLayout {
+	int64_t pixel_stride;
+	int64_t row_stride;
+	int64_t plane_stride;
+};
+
+enum PhaseOrder {
+	PHASE_ROW_MAJOR = 0,
+	PHASE_COLUMN_MAJOR = 1,
+};
+
+// Layout of N x M holograms stored in order, plane_stride elements apart (N * M if 0)
+PhaseLayout MakePhaseLayout(PhaseOrder order, uint64_t N, uint64_t M, uint64_t plane_stride = 0);
+
+// Lowest and highest element offsets the layout reaches for N x M x num_holograms phases
+void PhaseLayoutExtent(const PhaseLayout& layout, uint64_t N, uint64_t M, int num_holograms, int64_t& first, int64_t& last);
+
+// Phases read in place through layout. Doubles are rounded to float before quantising, so
+// the frame is the same as for a single() copy of the input.
+// The vectorised kernels need a monotonic lookup-table, like the contiguous float ones.
+void BitpackHologramRows(
+	const float* phase,
+	const PhaseLayout& layout,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackHologramRows(
+	const double* phase,
+	const PhaseLayout& layout,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackHologramsParallel(
+	ThreadPool& pool,
+	const float* phase,
+	const PhaseLayout& layout,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackHologramsParallel(
+	ThreadPool& pool,
+	const double* phase,
+	const PhaseLayout& layout,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
+
+// Copies phases read through layout into dense row-major floats, e.g. to upload them to the GPU
+void GatherPhases(const float* phase, const PhaseLayout& layout, float* dest, uint64_t N, uint64_t M, int num_holograms);
+void GatherPhases(const double* phase, const PhaseLayout& layout, float* dest, uint64_t N, uint64_t M, int num_holograms);
+
+// Size in bytes of the given number of levels stored in format
+uint64_t LevelBytes(LevelFormat format, uint64_t elements);
+
+// Pixel-major kernels for pre-quantised levels, no lookup-table involved.
+// Runs the best kernel available for isa on rows [row_begin, row_end).
+void BitpackLevelRows(
+	const uint8_t* levels,
+	LevelFormat format,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackLevelsParallel(
+	ThreadPool& pool,
+	const uint8_t* levels,
+	LevelFormat format,
+	uint8_t* hologram,
+	uint64_t N,
+	uint64_t M,
+	int num_holograms,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
+
+// Rewrites one hologram of a packed RGB frame (3 bytes per texel, see FrameStore) in place:
+// bit plane % 8 of colour channel plane / 8 of every texel, leaving the other 23 bits as they are.
+// phase holds the N x M phases of that hologram alone, pitch is the byte distance between RGB rows.
+void BitpackPlaneRows(
+	const float* phase,
+	int plane,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+// Same for a hologram given as levels
+void BitpackLevelPlaneRows(
+	const uint8_t* levels,
+	LevelFormat format,
+	int plane,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	const int* phase_map,
+	uint64_t row_begin,
+	uint64_t row_end,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackPlaneParallel(
+	ThreadPool& pool,
+	const float* phase,
+	int plane,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	const PhaseQuantiser& quantiser,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
+
+void BitpackLevelPlaneParallel(
+	ThreadPool& pool,
+	const uint8_t* levels,
+	LevelFormat format,
+	int plane,
+	uint8_t* rgb,
+	uint64_t pitch,
+	uint64_t N,
+	uint64_t M,
+	const int* phase_map,
+	BitpackISA isa = DetectBitpackISA());
@@ -0,0 +1,333 @@
+#include "frame_store.h"
+#include "bitpack.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+void FrameStore::Resize(uint64_t new_width, uint64_t new_height, uint64_t new_num_frames, uint8_t fill) {
+	std::unique_lock<std::shared_timed_mutex> lock(resize_mutex);
+	width = new_width;
+	height = new_height;
+	num_frames = new_num_frames;
+	fill_value = fill;
+
+	// Drop the old allocation first so we never hold both. The new one is left uninitialised,
+	// its pages are only committed once a slot is written.
+	data.reset();
+	total_bytes = FrameBytes() * num_frames;
+	data.reset((uint8_t*)std::malloc(total_bytes));
+	if (!data && total_bytes > 0) throw std::bad_alloc();
+
+	generations.reset(new std::atomic<uint64_t>[num_frames]);
+	leases.reset(new std::atomic<bool>[num_frames]);
+	blank.reset(new std::atomic<bool>[num_frames]);
+	for (uint64_t i = 0; i < num_frames; i++) {
+		generations[i].store(0);
+		leases[i].store(false);
+		blank[i].store(true);
+	};
+	Touch(0, num_frames);
+}
+
+bool FrameStore::ResizeFrames(uint64_t new_num_frames) {
+	if (new_num_frames == 0) return false;
+
+	// Called between two presents, so it doesn't wait for writers to finish
+	std::unique_lock<std::shared_timed_mutex> lock(resize_mutex, std::try_to_lock);
+	if (!lock.owns_lock()) return false;
+	for (uint64_t i = 0; i < num_frames; i++) {
+		if (IsLeased(i)) return false;
+	};
+
+	const uint64_t kept = std::min(num_frames, new_num_frames);
+	const uint64_t frame_bytes = FrameBytes();
+
+	// Slots below both sizes stay where they are, new ones are left uncommitted
+	uint8_t* new_data = (uint8_t*)std::realloc(data.get(), frame_bytes * new_num_frames);
+	if (new_data == nullptr) return false;
+	data.release();
+	data.reset(new_data);
+
+	std::unique_ptr<std::atomic<uint64_t>[]> new_generations(new std::atomic<uint64_t>[new_num_frames]);
+	std::unique_ptr<std::atomic<bool>[]> new_leases(new std::atomic<bool>[new_num_frames]);
+	std::unique_ptr<std::atomic<bool>[]> new_blank(new std::atomic<bool>[new_num_frames]);
+	for (uint64_t i = 0; i < new_num_frames; i++) {
+		new_generations[i].store(i < kept ? generations[i].load() : 0);
+		new_leases[i].store(false);
+		new_blank[i].store(i < kept ? blank[i].load() : true);
+	};
+
+	generations = std::move(new_generations);
+	leases = std::move(new_leases);
+	blank = std::move(new_blank);
+	const uint64_t old_num_frames = num_frames;
+	num_frames = new_num_frames;
+	total_bytes = frame_bytes * num_frames;
+	if (num_frames > old_num_frames) Touch(old_num_frames, num_frames - old_num_frames);
+
+	return true;
+}
+
+void FrameStore::FillBlank(uint64_t index) const {
+	if (!blank[index].load(std::memory_order_acquire)) return;
+
+	std::lock_guard<std::mutex> lock(fill_mutex);
+	if (blank[index].load(std::memory_order_relaxed)) {
+		std::memset(data.get() + index * FrameBytes(), fill_value, FrameBytes());
+		blank[index].store(false, std::memory_order_release);
+	};
+}
+
+uint8_t* FrameStore::Frame(uint64_t index) {
+	if (index >= num_frames) return nullptr;
+	FillBlank(index);
+	return data.get() + index * FrameBytes();
+}
+
+const uint8_t* FrameStore::Frame(uint64_t index) const {
+	if (index >= num_frames) return nullptr;
+	FillBlank(index);
+	return data.get() + index * FrameBytes();
+}
+
+uint8_t* FrameStore::FramesToOverwrite(uint64_t first, uint64_t count) {
+	if (first + count > num_frames || first + count < first) return nullptr;
+
+	// Claimed under the lock, so a fill that's already running finishes before the caller writes
+	std::lock_guard<std::mutex> lock(fill_mutex);
+	for (uint64_t i = first; i < first + count; i++) blank[i].store(false, std::memory_order_release);
+	return data.get() + first * FrameBytes();
+}
+
+bool FrameStore::IsBlank(uint64_t index) const {
+	if (index >= num_frames) return false;
+	return blank[index].load(std::memory_order_acquire);
+}
+
+bool FrameStore::Insert(const uint8_t* frames, uint64_t count, uint64_t offset, FrameFormat format, ThreadPool* pool) {
+
+	auto frames_lock = LockFrames();
+
+	if (offset + count > num_frames || offset + count < offset) {
+		// Exceeds the maximum number of frames we can store
+		return false;
+	};
+	if (format != FRAME_FORMAT_RGB && format != FRAME_FORMAT_RGBA) {
+		return false;
+	};
+
+	const uint64_t texels = count * width * height;
+	uint8_t* dest = FramesToOverwrite(offset, count);
+
+	// The slots aren't read again until they're shown, so they're written with streaming stores
+	auto convert = [&](uint64_t begin, uint64_t end) {
+		if (format == FRAME_FORMAT_RGB) {
+			StreamCopy(frames + 3 * begin, dest + 3 * begin, 3 * (end - begin));
+		} else {
+			CompactRGBAToRGB(frames + 4 * begin, dest + 3 * begin, end - begin, true);
+		};
+	};
+
+	if (pool != nullptr && texels >= INSERT_BLOCK_TEXELS) {
+		const uint64_t blocks = (texels + INSERT_BLOCK_TEXELS - 1) / INSERT_BLOCK_TEXELS;
+		pool->ParallelFor(blocks, [&](uint64_t begin, uint64_t end) {
+			convert(begin * INSERT_BLOCK_TEXELS, std::min(end * INSERT_BLOCK_TEXELS, texels));
+		});
+	} else {
+		convert(0, texels);
+	};
+
+	Touch(offset, count);
+
+	return true;
+}
+
+bool FrameStore::Read(uint64_t index, uint8_t* rgba) const {
+	auto frames_lock = LockFrames();
+	const uint8_t* src = Frame(index);
+	if (src == nullptr) return false;
+	ExpandRGBToRGBA(src, rgba, width * height);
+	return true;
+}
+
+uint64_t FrameStore::Generation(uint64_t index) const {
+	if (index >= num_frames) return 0;
+	return generations[index].load(std::memory_order_acquire);
+}
+
+void FrameStore::Touch(uint64_t first, uint64_t count) {
+	for (uint64_t i = first; i < first + count && i < num_frames; i++) {
+		generations[i].store(++last_generation, std::memory_order_release);
+	};
+}
+
+uint8_t* FrameStore::Acquire(uint64_t index) {
+	// Once leased, the slot keeps ResizeFrames from running
+	auto frames_lock = LockFrames();
+	if (index >= num_frames) return nullptr;
+
+	bool leased = false;
+	if (!leases[index].compare_exchange_strong(leased, true, std::memory_order_acquire)) {
+		// Someone else is writing it
+		return nullptr;
+	};
+	return Frame(index);
+}
+
+bool FrameStore::Commit(uint64_t index) {
+	if (!IsLeased(index)) return false;
+
+	// Bump the generation before the slot can be uploaded again
+	Touch(index);
+	leases[index].store(false, std::memory_order_release);
+	return true;
+}
+
+bool FrameStore::IsLeased(uint64_t index) const {
+	if (index >= num_frames) return false;
+	return leases[index].load(std::memory_order_acquire);
+}
+
+#ifdef PLM_X86
+PLM_TARGET("sse4.1")
+static inline void Store128(uint8_t* dest, __m128i v, bool stream) {
+	if (stream) {
+		_mm_stream_si128((__m128i*)dest, v);
+	} else {
+		_mm_storeu_si128((__m128i*)dest, v);
+	};
+}
+
+// 16 texels per iteration: three 16-byte RGB loads become four RGBA stores, alpha is
+// or'ed in by the same pass
+PLM_TARGET("sse4.1")
+static uint64_t ExpandRGBToRGBASSE41(const uint8_t* rgb, uint8_t* rgba, uint64_t texels, bool stream) {
+	const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+	uint64_t i = 0;
+	for (; i + 16 <= texels; i += 16) {
+		__m128i in0 = _mm_loadu_si128((const __m128i*)(rgb + 3 * i));
+		__m128i in1 = _mm_loadu_si128((const __m128i*)(rgb + 3 * i + 16));
+		__m128i in2 = _mm_loadu_si128((const __m128i*)(rgb + 3 * i + 32));
+
+		Store128(rgba + 4 * i, _mm_or_si128(_mm_shuffle_epi8(in0, spread), alpha), stream);
+		Store128(rgba + 4 * i + 16, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(in1, in0, 12), spread), alpha), stream);
+		Store128(rgba + 4 * i + 32, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(in2, in1, 8), spread), alpha), stream);
+		Store128(rgba + 4 * i + 48, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(in2, 4), spread), alpha), stream);
+	};
+	return i;
+}
+
+// The reverse, four RGBA loads merged into three RGB stores
+PLM_TARGET("sse4.1")
+static uint64_t CompactRGBAToRGBSSE41(const uint8_t* rgba, uint8_t* rgb, uint64_t texels, bool stream) {
+	const __m128i drop_alpha = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	uint64_t i = 0;
+	for (; i + 16 <= texels; i += 16) {
+		__m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(rgba + 4 * i)), drop_alpha);
+		__m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(rgba + 4 * i + 16)), drop_alpha);
+		__m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(rgba + 4 * i + 32)), drop_alpha);
+		__m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(rgba + 4 * i + 48)), drop_alpha);
+
+		Store128(rgb + 3 * i, _mm_or_si128(a, _mm_slli_si128(b, 12)), stream);
+		Store128(rgb + 3 * i + 16, _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)), stream);
+		Store128(rgb + 3 * i + 32, _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4)), stream);
+	};
+	return i;
+}
+
+PLM_TARGET("sse4.1")
+static uint64_t StreamCopySSE41(const uint8_t* src, uint8_t* dest, uint64_t bytes) {
+	uint64_t i = 0;
+	for (; i + 64 <= bytes; i += 64) {
+		for (int k = 0; k < 64; k += 16) {
+			_mm_stream_si128((__m128i*)(dest + i + k), _mm_loadu_si128((const __m128i*)(src + i + k)));
+		};
+	};
+	return i;
+}
+
+static void StreamFence() {
+	_mm_sfence();
+}
+#endif
+
+// Texels converted one at a time until dest + dest_texel_bytes * i is 16-byte aligned, and
+// whether it ever gets there (within 16 texels) so the vector loop can stream
+static uint64_t AlignHead(const uint8_t* dest, uint64_t dest_texel_bytes, uint64_t texels, bool& aligned) {
+	for (uint64_t i = 0; i < 16 && i < texels; i++) {
+		if (((uintptr_t)(dest + dest_texel_bytes * i) & 15) == 0) {
+			aligned = true;
+			return i;
+		};
+	};
+	aligned = false;
+	return 0;
+}
+
+static void ExpandRGBToRGBAScalar(const uint8_t* rgb, uint8_t* rgba, uint64_t begin, uint64_t end) {
+	for (uint64_t i = begin; i < end; i++) {
+		rgba[4 * i + 0] = rgb[3 * i + 0];
+		rgba[4 * i + 1] = rgb[3 * i + 1];
+		rgba[4 * i + 2] = rgb[3 * i + 2];
+		rgba[4 * i + 3] = 255;
+	};
+}
+
+static void CompactRGBAToRGBScalar(const uint8_t* rgba, uint8_t* rgb, uint64_t begin, uint64_t end) {
+	for (uint64_t i = begin; i < end; i++) {
+		rgb[3 * i + 0] = rgba[4 * i + 0];
+		rgb[3 * i + 1] = rgba[4 * i + 1];
+		rgb[3 * i + 2] = rgba[4 * i + 2];
+	};
+}
+
+void ExpandRGBToRGBA(const uint8_t* rgb, uint8_t* rgba, uint64_t texels, bool stream) {
+	uint64_t done = 0;
+#ifdef PLM_X86
+	if (DetectBitpackISA() >= BITPACK_ISA_SSE41) {
+		bool aligned = false;
+		uint64_t head = stream ? AlignHead(rgba, 4, texels, aligned) : 0;
+		stream = stream && aligned;
+		ExpandRGBToRGBAScalar(rgb, rgba, 0, head);
+		done = head + ExpandRGBToRGBASSE41(rgb + 3 * head, rgba + 4 * head, texels - head, stream);
+		if (stream) StreamFence();
+	};
+#endif
+	ExpandRGBToRGBAScalar(rgb, rgba, done, texels);
+}
+
+void CompactRGBAToRGB(const uint8_t* rgba, uint8_t* rgb, uint64_t texels, bool stream) {
+	uint64_t done = 0;
+#ifdef PLM_X86
+	if (DetectBitpackISA() >= BITPACK_ISA_SSE41) {
+		bool aligned = false;
+		uint64_t head = stream ? AlignHead(rgb, 3, texels, aligned) : 0;
+		stream = stream && aligned;
+		CompactRGBAToRGBScalar(rgba, rgb, 0, head);
+		done = head + CompactRGBAToRGBSSE41(rgba + 4 * head, rgb + 3 * head, texels - head, stream);
+		if (stream) StreamFence();
+	};
+#endif
+	CompactRGBAToRGBScalar(rgba, rgb, done, texels);
+}
+
+void StreamCopy(const uint8_t* src, uint8_t* dest, uint64_t bytes) {
+	uint64_t done = 0;
+#ifdef PLM_X86
+	if (DetectBitpackISA() >= BITPACK_ISA_SSE41) {
+		bool aligned = false;
+		uint64_t head = AlignHead(dest, 1, bytes, aligned);
+		if (aligned) {
+			std::memcpy(dest, src, head);
+			done = head + StreamCopySSE41(src + head, dest + head, bytes - head);
+			StreamFence();
+		};
+	};
+#endif
+	std::memcpy(dest + done, src + done, bytes - done);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "thread_pool.h"
+
+// Compact frame store.
+//
+// The PLM only reads the 24 RGB bits of every texel from the video signal, so frames are
+// kept as packed RGB (3 bytes per texel, 12 bytes per 2x2 superpixel) instead of RGBA.
+// The alpha byte is added back when a frame is uploaded to the display texture.
+//
+// Every slot carries a generation number that changes whenever its contents do, so the
+// presenter can skip uploading a frame it has already sent to the GPU.
+//
+// Resize only reserves the memory: slots start out blank and are filled the first time
+// they're accessed, or never if the first write covers the whole frame (FramesToOverwrite),
+// so the OS commits their pages on first use rather than up front.
+//
+// A slot can also be leased to a producer that writes it in place (Acquire), e.g. a
+// hologram generator or a file loader. Presenters don't upload a leased slot, they keep
+// showing what they last sent, which during playback is another slot's frame. Commit ends the
+// lease and marks the slot changed.
+//
+// ResizeFrames moves the slots. Pointers from Frame() and FramesToOverwrite() are only valid
+// while LockFrames() is held, which makes ResizeFrames fail rather than free them. Insert,
+// Read and Acquire hold it themselves.
+
+// Layout of frames handed to Insert, matching the type argument of InsertPLMFrame
+enum FrameFormat {
+	FRAME_FORMAT_RGB = 0,
+	FRAME_FORMAT_RGBA = 1,
+};
+
+const uint64_t FRAME_STORE_TEXEL_BYTES = 3;
+
+// Texels converted per work item when Insert is split between threads
+const uint64_t INSERT_BLOCK_TEXELS = 1 << 16;
+
+class FrameStore {
+public:
+	// Reallocates the store for num_frames blank frames of width x height texels, which read
+	// as every byte set to fill
+	void Resize(uint64_t width, uint64_t height, uint64_t num_frames, uint8_t fill = 255);
+
+	// Grows or shrinks the store to num_frames frames of the same size. Slots below both sizes
+	// keep their contents and generation, new ones start blank. Fails while a slot is leased or
+	// the frames are locked, or if num_frames is 0.
+	bool ResizeFrames(uint64_t num_frames);
+
+	// Shared lock that keeps slot pointers valid, see ResizeFrames
+	std::shared_lock<std::shared_timed_mutex> LockFrames() const { return std::shared_lock<std::shared_timed_mutex>(resize_mutex); };
+
+	uint64_t Width() const { return width; };
+	uint64_t Height() const { return height; };
+	uint64_t NumFrames() const { return num_frames; };
+	uint64_t Pitch() const { return FRAME_STORE_TEXEL_BYTES * width; };
+	uint64_t FrameBytes() const { return Pitch() * height; };
+	uint64_t TotalBytes() const { return total_bytes; };
+
+	// Packed RGB data of a frame, nullptr if index is out of range. A blank frame is filled first.
+	uint8_t* Frame(uint64_t index);
+	const uint8_t* Frame(uint64_t index) const;
+
+	// Data of slots [first, first + count) for a caller that writes every byte of them, so
+	// blank ones aren't filled first. nullptr if they're out of range.
+	uint8_t* FramesToOverwrite(uint64_t first, uint64_t count = 1);
+
+	// Slot hasn't been written or filled since the last Resize
+	bool IsBlank(uint64_t index) const;
+
+	// Byte every texel of a blank slot reads as
+	uint8_t FillValue() const { return fill_value; };
+
+	// Copies num_frames consecutive frames into slots [offset, offset + num_frames).
+	// RGBA frames drop their alpha byte. Returns false if they don't fit.
+	// With a pool the copy is split between its threads.
+	bool Insert(const uint8_t* frames, uint64_t num_frames, uint64_t offset, FrameFormat format, ThreadPool* pool = nullptr);
+
+	// Writes frame index as RGBA (alpha 255) into rgba, which holds 4 * width * height bytes
+	bool Read(uint64_t index, uint8_t* rgba) const;
+
+	// Generation of a slot, 0 if index is out of range. Read it before copying the frame out:
+	// a write that lands during the copy bumps it again afterwards.
+	uint64_t Generation(uint64_t index) const;
+
+	// Marks slots [first, first + count) as changed. Call it after writing through Frame().
+	void Touch(uint64_t first, uint64_t count = 1);
+
+	// Leases a slot for writing in place, Pitch() bytes per row. Returns nullptr if index is
+	// out of range or the slot is already leased. Resize ends every lease and invalidates the pointer.
+	uint8_t* Acquire(uint64_t index);
+
+	// Ends the lease on a slot and marks it changed. False if it wasn't leased.
+	bool Commit(uint64_t index);
+
+	bool IsLeased(uint64_t index) const;
+
+private:
+	uint64_t width = 0;
+	uint64_t height = 0;
+	uint64_t num_frames = 0;
+	// malloc'ed, so ResizeFrames can realloc it (large blocks are remapped rather than copied)
+	struct FreeDeleter { void operator()(uint8_t* p) const { std::free(p); }; };
+	std::unique_ptr<uint8_t, FreeDeleter> data;
+	uint64_t total_bytes = 0;
+	uint8_t fill_value = 255;
+
+	std::unique_ptr<std::atomic<uint64_t>[]> generations;
+	std::unique_ptr<std::atomic<bool>[]> leases;
+
+	void FillBlank(uint64_t index) const;
+	mutable std::unique_ptr<std::atomic<bool>[]> blank;
+	mutable std::mutex fill_mutex;                  // Held while a blank slot is filled or claimed
+	mutable std::shared_timed_mutex resize_mutex;   // Shared by slot users, exclusive to resizes
+	std::atomic<uint64_t> last_generation{ 0 };   // Shared by all slots, so numbers are never reused
+};
+
+// Texel format conversions between the store and RGBA frames, vectorised on SSE4.1 CPUs.
+// With stream the output goes out with non-temporal stores, for destinations that aren't
+// read back soon (frame-store slots, mapped textures).
+void ExpandRGBToRGBA(const uint8_t* rgb, uint8_t* rgba, uint64_t texels, bool stream = false);
+void CompactRGBAToRGB(const uint8_t* rgba, uint8_t* rgb, uint64_t texels, bool stream = false);
+
+// memcpy with non-temporal stores
+void StreamCopy(const uint8_t* src, uint8_t* dest, uint64_t bytes);
@@ -0,0 +1,80 @@
+#include "headless_presenter.h"
+
+#include <algorithm>
+#include <thread>
+
+HeadlessPresenter::HeadlessPresenter(FrameStore& store, Sequencer& sequencer)
+	: store(store), sequencer(sequencer), start(std::chrono::steady_clock::now()) {
+}
+
+void HeadlessPresenter::SetRefreshRate(double hz) {
+	if (hz > 0.0) refresh_rate = hz;
+}
+
+bool HeadlessPresenter::Upload(uint64_t slot) {
+
+	auto frames_lock = store.LockFrames();
+	// Like the window, a blank slot is sent as a constant without filling it in the store
+	const bool blank = store.IsBlank(slot);
+	const uint8_t* frame = blank ? nullptr : store.Frame(slot);
+	uint64_t generation = store.Generation(slot);
+	// A leased slot is being written, the sink keeps the last frame until it's committed
+	if ((frame == nullptr && !blank) || store.IsLeased(slot) || (slot == uploaded_slot && generation == uploaded_generation)) {
+		uploads_skipped++;
+		return false;
+	};
+
+	const uint64_t texels = store.Width() * store.Height();
+	if (sink.size() != 4 * texels) sink.resize(4 * texels);
+	if (blank) {
+		std::fill(sink.begin(), sink.end(), store.FillValue());
+		for (uint64_t t = 0; t < texels; t++) sink[4 * t + 3] = 255;
+	} else {
+		ExpandRGBToRGBA(frame, sink.data(), texels);
+	};
+
+	uploaded_slot = slot;
+	uploaded_generation = generation;
+	uploads++;
+	return true;
+}
+
+void HeadlessPresenter::Run(uint64_t num_vsyncs) {
+
+	const double period = 1.0 / refresh_rate;
+
+	// Carry on from the last simulated vsync rather than catching up on the time in between
+	start = std::chrono::steady_clock::now() - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(simulated_time));
+
+	for (uint64_t v = 0; v < num_vsyncs; v++) {
+		PresentRecord record = {};
+
+		if (sequencer.SequenceDone()) {
+			simulated_time += sequence_end_delay / 1000.0;
+			if (paced) std::this_thread::sleep_for(std::chrono::milliseconds(sequence_end_delay));
+			record.plm_stopped = true;
+		};
+
+		sequencer.BeginFrame();
+		record.slot = sequencer.Slot();
+		record.frame_index = sequencer.FrameIndex();
+		record.uploaded = Upload(record.slot);
+
+		// Present, waiting for the simulated vblank when paced
+		simulated_time += period;
+		if (paced) {
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>(simulated_time)));
+		};
+
+		record.vsync = vsync++;
+		record.time = simulated_time;
+		record.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		record.plm_started = sequencer.EndFrame();
+		record.buffer_index = sequencer.BufferIndex();
+
+		log.push_back(record);
+		if (on_present) on_present(record);
+	};
+}
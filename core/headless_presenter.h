@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "frame_store.h"
+#include "sequencer.h"
+
+// Presenter without a window or GPU.
+//
+// Steps the sequencer exactly like the UI loop does, but "presents" into a null sink on a
+// simulated vsync clock. Frames are still expanded to RGBA when the slot or its contents
+// change, so upload costs show up in the timings. Every vsync is logged with its simulated
+// and measured time and the slot shown, for pacing, sequencing and throughput benchmarks.
+
+struct PresentRecord {
+	uint64_t vsync;           // Vsyncs since the presenter was created
+	double time;              // Simulated present time, in seconds
+	double wall_time;         // Measured present time, in seconds
+	uint64_t slot;            // Frame-store slot shown
+	int64_t frame_index;      // Position in the frame order
+	int64_t buffer_index;     // Camera trigger buffer index after the present
+	bool uploaded;            // The frame was copied into the sink
+	bool plm_started;         // The first frame of a sequence went out (PLM::Play in the UI loop)
+	bool plm_stopped;         // A sequence ended before this vsync (PLM::Stop in the UI loop)
+};
+
+class HeadlessPresenter {
+public:
+	HeadlessPresenter(FrameStore& store, Sequencer& sequencer);
+
+	// Simulated display refresh rate, 60 Hz by default
+	void SetRefreshRate(double hz);
+	double RefreshRate() const { return refresh_rate; };
+
+	// Paced: every vsync waits until its simulated time, like Present(1, 0) does.
+	// Unpaced: vsyncs run back to back, which measures throughput. Unpaced by default.
+	void SetPaced(bool paced_vsync) { paced = paced_vsync; };
+
+	// Wait after the last frame of a sequence before stopping, like delay in the UI loop
+	void SetSequenceEndDelay(int ms) { sequence_end_delay = ms; };
+
+	// Called after every present, e.g. to issue sequencer commands on a given vsync
+	void SetCallback(std::function<void(const PresentRecord&)> callback) { on_present = callback; };
+
+	// Runs num_vsyncs vsyncs on the calling thread
+	void Run(uint64_t num_vsyncs);
+
+	const std::vector<PresentRecord>& Log() const { return log; };
+	void ClearLog() { log.clear(); };
+
+	uint64_t Uploads() const { return uploads; };
+	uint64_t UploadsSkipped() const { return uploads_skipped; };
+
+private:
+	bool Upload(uint64_t slot);
+
+	FrameStore& store;
+	Sequencer& sequencer;
+
+	double refresh_rate = 60.0;
+	bool paced = false;
+	int sequence_end_delay = 0;
+	std::function<void(const PresentRecord&)> on_present;
+
+	std::chrono::steady_clock::time_point start;
+	uint64_t vsync = 0;
+	double simulated_time = 0.0;
+
+	std::vector<uint8_t> sink;              // Stand-in for the RGBA display texture
+	uint64_t uploaded_slot = UINT64_MAX;
+	uint64_t uploaded_generation = 0;
+	uint64_t uploads = 0;
+	uint64_t uploads_skipped = 0;
+
+	std::vector<PresentRecord> log;
+};
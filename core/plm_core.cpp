@@ -0,0 +1,213 @@
+#include "plm_core.h"
+
+#include <algorithm>
+
+const float DEFAULT_LOOKUP_TABLE[QUANTISER_LUT_SIZE] = { 0, 0.0100, 0.0205, 0.0422, 0.0560, 0.0727, 0.1131, 0.1734, 0.3426, 0.3707, 0.4228, 0.4916, 0.5994, 0.6671, 0.7970, 0.9375, 1.0 };
+
+const int DEFAULT_PHASE_MAP[PHASE_MAP_SIZE] = {
+	0, 0, 0, 0,
+	1, 0, 0, 0,
+	0, 1, 0, 0,
+	1, 1, 0, 0,
+	0, 0, 1, 0,
+	1, 0, 1, 0,
+	0, 1, 1, 0,
+	1, 1, 1, 0,
+	0, 0, 0, 1,
+	1, 0, 0, 1,
+	0, 1, 0, 1,
+	1, 1, 0, 1,
+	0, 0, 1, 1,
+	1, 0, 1, 1,
+	0, 1, 1, 1,
+	1, 1, 1, 1
+};
+
+PLMCore::PLMCore() : quantiser(DEFAULT_LOOKUP_TABLE) {
+	std::copy(DEFAULT_PHASE_MAP, DEFAULT_PHASE_MAP + PHASE_MAP_SIZE, phase_map);
+}
+
+void PLMCore::SetLookupTable(const float* lut) {
+	// The quantiser table has to be rebuilt whenever the lookup-table changes
+	quantiser.Build(lut);
+}
+
+void PLMCore::SetPhaseMap(const int* map) {
+	std::copy(map, map + PHASE_MAP_SIZE, phase_map);
+}
+
+void PLMCore::SetBitpackThreads(unsigned int num_threads) {
+	bitpack_threads = num_threads;
+	// Only resize a running pool, otherwise it's created with this size when first needed
+	if (bitpack_pool.IsStarted()) bitpack_pool.Resize(bitpack_threads);
+}
+
+void PLMCore::SetBitpackAffinity(bool pin) {
+	bitpack_affinity = pin;
+	bitpack_pool.SetAffinity(bitpack_affinity);
+}
+
+void PLMCore::StartBitpackPool() {
+	bitpack_pool.Resize(bitpack_threads);
+	bitpack_pool.SetAffinity(bitpack_affinity);
+}
+
+template <typename T>
+bool PLMCore::PackOnPool(const T* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms) {
+
+	// Check if the number of holograms is within the limit
+	if (num_holograms > 24) {
+		return false;
+	};
+
+	if (!bitpack_pool.IsStarted()) StartBitpackPool();
+
+	// Rows are split between the pool threads. Each runs the vectorised kernel on CPUs that support it, scalar loop otherwise
+	BitpackHologramsParallel(bitpack_pool, phase, hologram, N, M, num_holograms, quantiser, phase_map);
+
+	return true;
+}
+
+template <typename T>
+bool PLMCore::PackOnPool(const T* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms) {
+
+	if (num_holograms > 24) {
+		return false;
+	};
+
+	if (!bitpack_pool.IsStarted()) StartBitpackPool();
+
+	BitpackHologramsParallel(bitpack_pool, phase, layout, hologram, N, M, num_holograms, quantiser, phase_map);
+
+	return true;
+}
+
+bool PLMCore::BitpackHolograms(const float* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms) {
+	return PackOnPool(phase, hologram, N, M, num_holograms);
+}
+
+bool PLMCore::BitpackHolograms(const uint8_t* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms) {
+	return PackOnPool(phase, hologram, N, M, num_holograms);
+}
+
+bool PLMCore::BitpackHolograms(const uint16_t* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms) {
+	return PackOnPool(phase, hologram, N, M, num_holograms);
+}
+
+bool PLMCore::BitpackHolograms(const float* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms) {
+	return PackOnPool(phase, layout, hologram, N, M, num_holograms);
+}
+
+bool PLMCore::BitpackHolograms(const double* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms) {
+	return PackOnPool(phase, layout, hologram, N, M, num_holograms);
+}
+
+bool PLMCore::BitpackLevels(const uint8_t* levels, LevelFormat format, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms) {
+
+	if (num_holograms > 24) {
+		return false;
+	};
+
+	if (!bitpack_pool.IsStarted()) StartBitpackPool();
+
+	BitpackLevelsParallel(bitpack_pool, levels, format, hologram, N, M, num_holograms, phase_map);
+
+	return true;
+}
+
+bool PLMCore::BitpackAndInsertBatch(const float* phase, uint64_t N, uint64_t M, uint64_t num_holograms, uint64_t offset) {
+
+	// Keeps the store from being resized under the packing threads
+	auto frames_lock = frame_store.LockFrames();
+
+	const uint64_t num_frames = (num_holograms + HOLOGRAMS_PER_FRAME - 1) / HOLOGRAMS_PER_FRAME;
+	if (num_frames == 0 || offset + num_frames > frame_store.NumFrames() || offset + num_frames < offset) {
+		// Exceeds the maximum number of frames we can store
+		return false;
+	};
+	if (frame_store.Width() != 2 * N || frame_store.Height() != 2 * M) {
+		return false;
+	};
+
+	if (!bitpack_pool.IsStarted()) StartBitpackPool();
+
+	// Every byte of the slots is packed, blank ones don't need filling first
+	uint8_t* frames = frame_store.FramesToOverwrite(offset, num_frames);
+	const uint64_t frame_bytes = frame_store.FrameBytes();
+
+	const uint64_t plane_elements = N * M;
+	const uint64_t block_rows = BATCH_BLOCK_ROWS;
+	const uint64_t blocks_per_frame = (M + block_rows - 1) / block_rows;
+
+	// Work items are blocks of phase rows across every frame, so a single frame still spreads over
+	// all threads. Blocks are packed as RGB straight into their slot.
+	bitpack_pool.ParallelFor(num_frames * blocks_per_frame, [&](uint64_t begin, uint64_t end) {
+		for (uint64_t item = begin; item < end; item++) {
+			const uint64_t f = item / blocks_per_frame;
+			const uint64_t j = (item % blocks_per_frame) * block_rows;
+			const int holograms = (int)std::min<uint64_t>(HOLOGRAMS_PER_FRAME, num_holograms - f * HOLOGRAMS_PER_FRAME);
+			const float* frame_phase = phase + f * HOLOGRAMS_PER_FRAME * plane_elements;
+
+			BitpackHologramRowsRGB(frame_phase, frames + f * frame_bytes, frame_store.Pitch(), N, M, holograms,
+				quantiser, phase_map, j, std::min(j + block_rows, M));
+		};
+	});
+
+	frame_store.Touch(offset, num_frames);
+
+	return true;
+}
+
+bool PLMCore::BitpackAndInsert(const float* phase, uint64_t N, uint64_t M, int num_holograms, uint64_t slot) {
+	if (num_holograms < 1 || num_holograms > HOLOGRAMS_PER_FRAME) return false;
+	return BitpackAndInsertBatch(phase, N, M, (uint64_t)num_holograms, slot);
+}
+
+bool PLMCore::InsertFrames(const uint8_t* frames, uint64_t num_frames, uint64_t offset, FrameFormat format) {
+	if (!bitpack_pool.IsStarted()) StartBitpackPool();
+	return frame_store.Insert(frames, num_frames, offset, format, &bitpack_pool);
+}
+
+bool PLMCore::UpdateHologramPlane(uint64_t slot, int plane, const float* phase) {
+
+	auto frames_lock = frame_store.LockFrames();
+	uint8_t* frame = frame_store.Frame(slot);
+	if (!frame || plane < 0 || plane >= HOLOGRAMS_PER_FRAME) {
+		return false;
+	};
+
+	if (!bitpack_pool.IsStarted()) StartBitpackPool();
+
+	BitpackPlaneParallel(bitpack_pool, phase, plane, frame, frame_store.Pitch(), frame_store.Width() / 2, frame_store.Height() / 2, quantiser, phase_map);
+	frame_store.Touch(slot);
+
+	return true;
+}
+
+bool PLMCore::UpdateHologramPlane(uint64_t slot, int plane, const uint8_t* levels, LevelFormat format) {
+
+	auto frames_lock = frame_store.LockFrames();
+	uint8_t* frame = frame_store.Frame(slot);
+	if (!frame || plane < 0 || plane >= HOLOGRAMS_PER_FRAME) {
+		return false;
+	};
+
+	if (!bitpack_pool.IsStarted()) StartBitpackPool();
+
+	BitpackLevelPlaneParallel(bitpack_pool, levels, format, plane, frame, frame_store.Pitch(), frame_store.Width() / 2, frame_store.Height() / 2, phase_map);
+	frame_store.Touch(slot);
+
+	return true;
+}
+
+void PLMCore::ResetFrames(uint64_t N, uint64_t M, uint64_t num_frames) {
+	sequencer.Reset(num_frames);
+	StartBitpackPool();
+	frame_store.Resize(2 * N, 2 * M, num_frames);
+}
+
+bool PLMCore::ResizeFrames(uint64_t num_frames) {
+	if (num_frames == 0 || sequencer.IsActive()) return false;
+	if (!frame_store.ResizeFrames(num_frames)) return false;
+	return sequencer.Resize(num_frames);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+
+#include "quantiser.h"
+#include "bitpack.h"
+#include "thread_pool.h"
+#include "frame_store.h"
+#include "sequencer.h"
+
+// Platform-neutral part of a PLM pipeline: the lookup-table and phase map, the CPU packer,
+// the frame store and the frame sequencer. Nothing in here depends on Windows, so it
+// builds on its own with GCC/Clang (see CMakeLists.txt). The DLL exports in plmctrl.cpp
+// are thin adapters over it, and keep the window, D3D11 presenter and debug UI.
+
+constexpr int PHASE_MAP_SIZE = QUANTISER_LEVELS * 4;
+constexpr int HOLOGRAMS_PER_FRAME = 24;
+
+// Phase rows packed per work item by BitpackAndInsertBatch
+constexpr uint64_t BATCH_BLOCK_ROWS = 16;
+
+// TI's default lookup-table
+extern const float DEFAULT_LOOKUP_TABLE[QUANTISER_LUT_SIZE];
+
+// Binary counting phase-map, has to be calibrated.
+extern const int DEFAULT_PHASE_MAP[PHASE_MAP_SIZE];
+
+class PLMCore {
+public:
+	PLMCore();
+
+	PLMCore(const PLMCore&) = delete;
+	PLMCore& operator=(const PLMCore&) = delete;
+
+	// Lookup-table (QUANTISER_LUT_SIZE phases) and phase map (PHASE_MAP_SIZE bits)
+	void SetLookupTable(const float* lut);
+	const float* LookupTable() const { return quantiser.Phases(); };
+	void SetPhaseMap(const int* map);
+	const int* PhaseMap() const { return phase_map; };
+
+	const PhaseQuantiser& Quantiser() const { return quantiser; };
+	unsigned int QuantisePhase(float phaseVal) const { return quantiser(phaseVal); };
+
+	// CPU bitpacking threads, 0 uses every hardware thread. Applied right away if the pool is running.
+	void SetBitpackThreads(unsigned int num_threads);
+	void SetBitpackAffinity(bool pin);
+	const ThreadPool& BitpackPool() const { return bitpack_pool; };
+
+	// Joins the packing threads, they're started again when needed
+	void StopBitpackPool() { bitpack_pool.Shutdown(); };
+
+	// Stops the packing threads without joining them, for DLL unload (see ThreadPool::Release)
+	void ReleaseBitpackPool() { bitpack_pool.Release(); };
+
+	// Packs up to 24 N x M holograms into a 2N x 2M RGBA frame on the CPU threads.
+	// Fixed-point phases are uint8 v / 255 and uint16 v / 65535.
+	bool BitpackHolograms(const float* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms);
+	bool BitpackHolograms(const uint8_t* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms);
+	bool BitpackHolograms(const uint16_t* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms);
+
+	// Phases read in place through layout, e.g. a column-major MATLAB array or a NumPy view
+	bool BitpackHolograms(const float* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms);
+	bool BitpackHolograms(const double* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms);
+
+	// Same for holograms that are already quantised to levels (see LevelFormat), no lookup-table involved
+	bool BitpackLevels(const uint8_t* levels, LevelFormat format, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms);
+
+	// Packs up to 24 N x M holograms straight into frame-store slot, which has to hold 2N x 2M
+	// frames. The frame is written once, as packed RGB, with no RGBA copy in between.
+	bool BitpackAndInsert(const float* phase, uint64_t N, uint64_t M, int num_holograms, uint64_t slot);
+
+	// Packs num_holograms N x M holograms, 24 per frame, into consecutive frame-store slots
+	// from offset. Frames are packed in parallel on the CPU threads. The last frame takes
+	// the remaining holograms if num_holograms isn't a multiple of 24.
+	bool BitpackAndInsertBatch(const float* phase, uint64_t N, uint64_t M, uint64_t num_holograms, uint64_t offset);
+
+	// Replaces hologram plane (0-23) of frame-store slot with one of N x M phases, where the
+	// slot's frames are 2N x 2M. The other 23 holograms of the slot are left as they are.
+	bool UpdateHologramPlane(uint64_t slot, int plane, const float* phase);
+	bool UpdateHologramPlane(uint64_t slot, int plane, const uint8_t* levels, LevelFormat format);
+
+	// Copies num_frames RGB or RGBA frames into frame-store slots from offset, split between the CPU threads
+	bool InsertFrames(const uint8_t* frames, uint64_t num_frames, uint64_t offset, FrameFormat format);
+
+	// Reallocates the frame store for num_frames 2N x 2M frames, resets the frame order
+	// and starts the packing threads
+	void ResetFrames(uint64_t N, uint64_t M, uint64_t num_frames);
+
+	// Changes the number of frames the store holds, keeping the stored frames and the frame
+	// order where they fit. Fails during a sequence or while a slot is leased.
+	bool ResizeFrames(uint64_t num_frames);
+
+	FrameStore& Frames() { return frame_store; };
+	Sequencer& Sequence() { return sequencer; };
+
+private:
+	void StartBitpackPool();
+	template <typename T> bool PackOnPool(const T* phase, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms);
+	template <typename T> bool PackOnPool(const T* phase, const PhaseLayout& layout, uint8_t* hologram, uint64_t N, uint64_t M, int num_holograms);
+
+	PhaseQuantiser quantiser;            // Holds the lookup-table
+	int phase_map[PHASE_MAP_SIZE];
+
+	ThreadPool bitpack_pool;
+	unsigned int bitpack_threads = 0;
+	bool bitpack_affinity = false;
+
+	FrameStore frame_store;
+	Sequencer sequencer;
+};
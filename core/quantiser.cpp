@@ -0,0 +1,106 @@
+#include "quantiser.h"
+
+#include <cmath>
+#include <cstring>
+
+unsigned int QuantisePhaseScan(const float* phases, float phaseVal) {
+	for (int level_num = 0; level_num < QUANTISER_LEVELS; level_num++) {
+		if ((phaseVal >= phases[level_num]) && (phaseVal < phases[level_num + 1])) {
+			if (std::fabs(phaseVal - phases[level_num]) < std::fabs(phaseVal - phases[level_num + 1])) {
+				return level_num;
+			};
+			return (level_num + 1) % QUANTISER_LEVELS;
+		}
+	}
+	return 0; // Default return if no condition is met
+}
+
+// Maps floats to unsigned integers with the same ordering, so we can bisect over
+// every representable float between two values.
+static uint32_t OrderedKey(float f) {
+	uint32_t u;
+	std::memcpy(&u, &f, sizeof(u));
+	return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+static float FromOrderedKey(uint32_t key) {
+	uint32_t u = (key & 0x80000000u) ? (key & 0x7FFFFFFFu) : ~key;
+	float f;
+	std::memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+// Levels of the fixed-point values 0 to max, standing for v / max
+static void BuildFixedPointLevels(const PhaseQuantiser& quantiser, uint32_t max, uint8_t* levels) {
+	for (uint32_t v = 0; v <= max; v++) {
+		levels[v] = (uint8_t)quantiser((float)v / (float)max);
+	};
+	std::memset(levels + max + 1, 0, 3);
+}
+
+PhaseQuantiser::PhaseQuantiser(const float* phases) {
+	Build(phases);
+}
+
+void PhaseQuantiser::Build(const float* lut) {
+
+	std::memcpy(phases, lut, sizeof(phases));
+
+	monotonic = true;
+	for (int k = 0; k < QUANTISER_LEVELS; k++) {
+		if (!(phases[k] <= phases[k + 1])) monotonic = false; // Also catches NaN
+	};
+
+	if (!monotonic) {
+		// No thresholds to speak of, everything goes through the scan
+		std::memset(table, SPLIT_BIN, sizeof(table));
+		for (int k = 0; k < QUANTISER_LEVELS; k++) thresholds[k] = phases[k + 1];
+		split_bins = QUANTISER_TABLE_SIZE;
+		BuildFixedPointLevels(*this, 255, levels_u8);
+		BuildFixedPointLevels(*this, 65535, levels_u16);
+		return;
+	};
+
+	// Within [phases[k], phases[k+1]) the scan returns k until the distance to the upper
+	// level is no longer larger, and k+1 from there on. That comparison is monotonic in x,
+	// so the first float where it flips can be found by bisection.
+	for (int k = 0; k < QUANTISER_LEVELS; k++) {
+		const float a = phases[k];
+		const float b = phases[k + 1];
+		uint32_t lo = OrderedKey(a);
+		uint32_t hi = OrderedKey(b);
+		while (lo < hi) {
+			uint32_t mid = lo + (hi - lo) / 2;
+			float x = FromOrderedKey(mid);
+			if (std::fabs(x - a) < std::fabs(x - b)) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			};
+		};
+		thresholds[k] = FromOrderedKey(lo);
+	};
+
+	auto count = [this](float x) {
+		unsigned int c = 0;
+		for (int k = 0; k < QUANTISER_LEVELS; k++) c += (x >= thresholds[k]);
+		return c;
+	};
+
+	const float bin_width = 1.0f / (float)QUANTISER_TABLE_SIZE;
+	split_bins = 0;
+	for (uint32_t bin = 0; bin < QUANTISER_TABLE_SIZE; bin++) {
+		float first = bin * bin_width;
+		float last = std::nextafter((bin + 1) * bin_width, 0.0f);
+		unsigned int c = count(first);
+		if (c == count(last)) {
+			table[bin] = (uint8_t)(c % QUANTISER_LEVELS);
+		} else {
+			table[bin] = SPLIT_BIN;
+			split_bins++;
+		};
+	};
+
+	BuildFixedPointLevels(*this, 255, levels_u8);
+	BuildFixedPointLevels(*this, 65535, levels_u16);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+// Phase quantiser for plmctrl.
+//
+// QuantisePhaseScan is the reference nearest-level rule: it walks the 17-entry
+// lookup-table and picks the closest of the two levels bracketing the phase value,
+// with the top level (1.0) wrapping back to level 0.
+//
+// PhaseQuantiser gives bit-identical results but replaces the scan with a dense
+// table of 2^16 entries covering [0, 1). Each phase value becomes one multiply and
+// one load. The few table bins that contain a decision threshold are flagged and
+// resolved with the reference scan, so the result never differs from it.
+//
+// Fixed-point phases, uint8 v standing for v / 255 and uint16 v for v / 65535, get
+// their own level tables with an entry per value, built from the same rule.
+
+constexpr int QUANTISER_LEVELS = 16;
+constexpr int QUANTISER_LUT_SIZE = QUANTISER_LEVELS + 1;
+constexpr int QUANTISER_TABLE_BITS = 16;
+constexpr uint32_t QUANTISER_TABLE_SIZE = 1u << QUANTISER_TABLE_BITS;
+
+// Reference nearest-level quantisation. phases must hold QUANTISER_LUT_SIZE entries.
+unsigned int QuantisePhaseScan(const float* phases, float phaseVal);
+
+class PhaseQuantiser {
+public:
+	explicit PhaseQuantiser(const float* phases);
+
+	// Rebuilds the table. Must be called every time the lookup-table changes.
+	void Build(const float* phases);
+
+	inline unsigned int operator()(float phaseVal) const {
+		// Out of range values (including NaN) are rare, leave them to the scan
+		if (!(phaseVal >= 0.0f && phaseVal < 1.0f)) return QuantisePhaseScan(phases, phaseVal);
+		uint8_t level = table[(uint32_t)(phaseVal * (float)QUANTISER_TABLE_SIZE)];
+		return level < SPLIT_BIN ? level : QuantisePhaseScan(phases, phaseVal);
+	};
+
+	// True if the lookup-table is non-decreasing. Only then are the thresholds valid.
+	bool IsMonotonic() const { return monotonic; };
+
+	// Decision thresholds: for a monotonic lookup-table, the level of x is
+	// (number of thresholds[k] <= x) % 16, for every float x.
+	const float* Thresholds() const { return thresholds; };
+
+	const float* Phases() const { return phases; };
+
+	// Level of every uint8 (v / 255) and uint16 (v / 65535) phase value
+	unsigned int operator()(uint8_t phaseVal) const { return levels_u8[phaseVal]; };
+	unsigned int operator()(uint16_t phaseVal) const { return levels_u16[phaseVal]; };
+	const uint8_t* LevelsU8() const { return levels_u8; };
+	const uint8_t* LevelsU16() const { return levels_u16; };
+
+	// Number of table bins that fall back to the scan
+	unsigned int SplitBins() const { return split_bins; };
+
+private:
+	static constexpr uint8_t SPLIT_BIN = 0x80;
+
+	uint8_t table[QUANTISER_TABLE_SIZE];
+	float thresholds[QUANTISER_LEVELS];
+	float phases[QUANTISER_LUT_SIZE];
+	uint8_t levels_u8[256 + 3];      // Padded so that a 32-bit load from any entry stays inside
+	uint8_t levels_u16[65536 + 3];
+	bool monotonic = false;
+	unsigned int split_bins = 0;
+};
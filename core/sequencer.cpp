@@ -0,0 +1,277 @@
+#include "sequencer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<SequencerStatus>::value, "SequencerStatus is published word by word");
+
+Sequencer::Sequencer() {
+	for (std::atomic<uint64_t>& word : status_words) word.store(0, std::memory_order_relaxed);
+	Publish();
+}
+
+void Sequencer::Reset(uint64_t num_slots) {
+	this->num_slots = num_slots;
+	order.resize(num_slots);
+	for (uint64_t i = 0; i < num_slots; i++) {
+		order[i] = i;
+	};
+	dwell.clear();
+	for (Command& command : commands) {
+		command.order.reset();
+		command.dwell.reset();
+	};
+	command_head.store(command_tail.load());
+	SetFrameIndex(frame_index);
+	Publish();
+}
+
+bool Sequencer::Resize(uint64_t num_slots) {
+
+	if (active || num_slots == 0) {
+		return false;
+	};
+
+	// An order covering the store follows its size, new positions are shown once
+	const uint64_t old_size = order.size();
+	if (old_size == this->num_slots) {
+		order.resize(num_slots);
+		if (!dwell.empty()) dwell.resize(num_slots, 1);
+	};
+	for (uint64_t i = 0; i < order.size(); i++) {
+		if (i >= old_size || order[i] >= num_slots) order[i] = i % num_slots;
+	};
+	this->num_slots = num_slots;
+	SetFrameIndex(frame_index);
+	Publish();
+
+	return true;
+}
+
+bool Sequencer::Push(CommandType type, int64_t value, std::unique_ptr<std::vector<uint64_t>> new_order,
+	std::unique_ptr<std::vector<uint32_t>> new_dwell) {
+
+	std::lock_guard<std::mutex> lock(push_mutex);
+
+	const uint64_t tail = command_tail.load(std::memory_order_relaxed);
+	if (tail - command_head.load(std::memory_order_acquire) >= SEQUENCER_QUEUE_SIZE) {
+		return false;
+	};
+
+	if (type == COMMAND_SET_ORDER) {
+		order_command = tail + 1;
+		order_length = new_order->size();
+	};
+
+	Command& command = commands[tail % SEQUENCER_QUEUE_SIZE];
+	command.type = type;
+	command.value = value;
+	command.order = std::move(new_order);
+	command.dwell = std::move(new_dwell);
+	command_tail.store(tail + 1, std::memory_order_release);
+
+	return true;
+}
+
+uint64_t Sequencer::QueuedPositions() {
+	// Length of the order once the queue is applied
+	std::lock_guard<std::mutex> lock(push_mutex);
+	if (order_command > command_head.load(std::memory_order_acquire)) return order_length;
+	return Status().positions;
+}
+
+bool Sequencer::SetOrder(const uint64_t* sequence, uint64_t length, const uint32_t* dwell) {
+
+	const uint64_t slots = Status().slots;
+	if (length == 0 || std::any_of(sequence, sequence + length, [&](uint64_t slot) { return slot >= slots; })) {
+		return false;
+	};
+	if (dwell && std::any_of(dwell, dwell + length, [](uint32_t vsyncs) { return vsyncs == 0; })) {
+		return false;
+	};
+
+	// Copied here, so the presenter only swaps it in. Dwell counts that are all 1 aren't kept.
+	std::unique_ptr<std::vector<uint32_t>> new_dwell;
+	if (dwell && std::any_of(dwell, dwell + length, [](uint32_t vsyncs) { return vsyncs != 1; })) {
+		new_dwell.reset(new std::vector<uint32_t>(dwell, dwell + length));
+	};
+	return Push(COMMAND_SET_ORDER, 0, std::unique_ptr<std::vector<uint64_t>>(new std::vector<uint64_t>(sequence, sequence + length)),
+		std::move(new_dwell));
+}
+
+bool Sequencer::Start(int number_of_frames) {
+
+	// Checked again when applied, the order may be resized in between
+	if (number_of_frames < 0 || (uint64_t)number_of_frames > QueuedPositions()) {
+		return false;
+	};
+
+	return Push(COMMAND_START, number_of_frames);
+}
+
+bool Sequencer::SetFrame(uint64_t position) {
+
+	if (position >= QueuedPositions()) {
+		// Exceeds the maximum number of holograms we can store
+		return false;
+	};
+
+	return Push(COMMAND_SET_FRAME, (int64_t)position);
+}
+
+void Sequencer::SetFrameIndex(int64_t position) {
+	frame_index = std::max<int64_t>(0, std::min<int64_t>(position, (int64_t)order.size() - 1));
+}
+
+void Sequencer::Hold() {
+	Push(COMMAND_HOLD, 0);
+}
+
+uint64_t Sequencer::ApplyCommands() {
+
+	const uint64_t tail = command_tail.load(std::memory_order_acquire);
+	uint64_t head = command_head.load(std::memory_order_relaxed);
+
+	for (; head != tail; head++) {
+		Command& command = commands[head % SEQUENCER_QUEUE_SIZE];
+		switch (command.type) {
+		case COMMAND_SET_ORDER:
+			// The store may have shrunk since SetOrder checked it, entries past the end are remapped
+			// the way Resize remaps the live order
+			for (uint64_t i = 0; i < command.order->size(); i++) {
+				if ((*command.order)[i] >= num_slots) (*command.order)[i] = i % num_slots;
+			};
+			order.swap(*command.order);
+			if (command.dwell) dwell.swap(*command.dwell);
+			else dwell.clear();
+			SetFrameIndex(frame_index);
+			held = 0;
+			break;
+		case COMMAND_START:
+			if ((uint64_t)command.value > order.size()) break;
+			frames_to_play = (int)command.value;
+			frames_in_sequence = (int)command.value;
+			active = true;
+			first_frame_trigger = true;
+			start_pending = true;
+			break;
+		case COMMAND_SET_FRAME:
+			if ((uint64_t)command.value < order.size()) frame_index = command.value;
+			held = 0;
+			break;
+		case COMMAND_HOLD:
+			first_frame_trigger = true;
+			break;
+		};
+		command.order.reset();
+		command.dwell.reset();
+	};
+
+	return head;
+}
+
+void Sequencer::Publish() {
+
+	SequencerStatus status = {};
+	status.mode = mode;
+	status.active = active;
+	status.camera_trigger = camera_trigger;
+	status.frames_to_play = frames_to_play;
+	status.frames_in_sequence = frames_in_sequence;
+	status.frame_index = frame_index;
+	status.buffer_index = buffer_index;
+	status.slot = Slot();
+	status.positions = order.size();
+	status.slots = num_slots;
+	status.vsync = vsync;
+
+	uint64_t words[STATUS_WORDS] = {};
+	std::memcpy(words, &status, sizeof(status));
+
+	const uint64_t sequence = status_sequence.load(std::memory_order_relaxed);
+	status_sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (size_t i = 0; i < STATUS_WORDS; i++) {
+		status_words[i].store(words[i], std::memory_order_relaxed);
+	};
+	status_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+SequencerStatus Sequencer::Status() const {
+
+	uint64_t words[STATUS_WORDS];
+	uint64_t before, after;
+
+	// Retries while the presenter is publishing, which only takes a few stores
+	do {
+		before = status_sequence.load(std::memory_order_acquire);
+		for (size_t i = 0; i < STATUS_WORDS; i++) {
+			words[i] = status_words[i].load(std::memory_order_relaxed);
+		};
+		std::atomic_thread_fence(std::memory_order_acquire);
+		after = status_sequence.load(std::memory_order_relaxed);
+	} while ((before & 1) || before != after);
+
+	SequencerStatus status;
+	std::memcpy(&status, words, sizeof(status));
+	return status;
+}
+
+void Sequencer::BeginFrame() {
+
+	const uint64_t applied = ApplyCommands();
+
+	if (SequenceDone()) {
+		active = false;
+		buffer_index = -1; // buffer_index = -1 signals that the sequence has ended
+		mode = SEQUENCER_IDLE;
+		camera_trigger = false;
+	};
+
+	// Armed once per Start, the first position may be held for several vsyncs
+	if (start_pending && active) {
+		start_pending = false;
+		starting = true;
+		mode = SEQUENCER_PLAYING;
+		frame_index = 0;
+		held = 0;
+		first_frame_trigger = false;
+	};
+
+	// Callers check against the published order once the commands are marked as applied
+	Publish();
+	command_head.store(applied, std::memory_order_release);
+}
+
+bool Sequencer::EndFrame() {
+
+	bool started = false;
+
+	buffer_index = camera_trigger ? buffer_index + 1 : -1;
+
+	if (mode == SEQUENCER_PLAYING && starting) {
+		starting = false;
+		camera_trigger = true;
+		buffer_index = 0;
+		started = true;
+	};
+
+	// first_frame_trigger is there to know that the first frame was already sent to the GPU buffer queue.
+	// Positions are held for their dwell count, the buffer index still counts every vsync.
+	// The vsync after the last position isn't held.
+	if (frames_to_play >= 0 && !first_frame_trigger) {
+		if (frames_to_play > 0 && ++held < Dwell(frame_index)) {
+			// Shown again on the next vsync
+		} else {
+			held = 0;
+			SetFrameIndex(frame_index + 1);
+			frames_to_play--;
+		};
+	};
+
+	vsync++;
+	Publish();
+
+	return started;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Frame sequencer, stepped once per vsync by a presenter.
+//
+// The frame order maps sequence positions to frame-store slots. Its length is independent
+// of the number of slots, so a long scan can revisit the same frames. Start(n) arms a
+// sequence of n frames: the next vsync shows position 0 and the PLM is started right after
+// it is presented. Each following vsync advances one position, or holds it for the entry's
+// dwell count, and counts up the buffer index used for camera triggering. Once all frames
+// are out the sequence ends and the buffer index goes back to -1.
+//
+// A presenter drives it like this, every vsync:
+//   if (sequencer.SequenceDone()) { wait, stop the PLM }
+//   sequencer.BeginFrame();
+//   show sequencer.Slot(), present
+//   if (sequencer.EndFrame()) { start the PLM }
+//
+// The presenter's thread owns the sequencer state. SetOrder, Start, SetFrame and Hold can
+// be called from any other thread: they're queued and applied by the next BeginFrame, so a
+// sequence always starts on the vsync after the call. Other threads read the state through
+// Status(), a snapshot published after every BeginFrame and EndFrame, without ever
+// blocking the presenter.
+
+enum SequencerMode {
+	SEQUENCER_IDLE = 0,
+	SEQUENCER_PLAYING = 1,
+	SEQUENCER_CONTINUOUS = 2,
+};
+
+// Snapshot of the sequencer, see Sequencer::Status
+struct SequencerStatus {
+	SequencerMode mode;
+	bool active;
+	bool camera_trigger;
+	int frames_to_play;
+	int frames_in_sequence;
+	int64_t frame_index;
+	int64_t buffer_index;
+	uint64_t slot;
+	uint64_t positions;                    // Length of the frame order
+	uint64_t slots;                        // Number of frame-store slots it can refer to
+	uint64_t vsync;                        // Number of EndFrame calls
+};
+
+// SetOrder/Start/SetFrame/Hold calls that can be queued before the presenter applies them
+constexpr uint64_t SEQUENCER_QUEUE_SIZE = 64;
+
+class Sequencer {
+public:
+	Sequencer();
+
+	Sequencer(const Sequencer&) = delete;
+	Sequencer& operator=(const Sequencer&) = delete;
+
+	// Identity order over num_slots slots, drops queued commands. Not while a presenter runs.
+	void Reset(uint64_t num_slots);
+
+	// Changes the number of slots. An order as long as the store grows or shrinks with it, new
+	// positions mapping to themselves. Positions whose slot no longer exists map to position
+	// modulo num_slots. Fails during a sequence. Presenter thread only.
+	bool Resize(uint64_t num_slots);
+
+	// Replaces the order with length slot indices, each below the number of slots. During a
+	// sequence, entry i is shown for dwell[i] vsyncs (at least 1, all 1 without dwell). Copied,
+	// then queued. If the store shrinks before it's applied, entries past the end map to their
+	// position modulo the number of slots, as in Resize.
+	bool SetOrder(const uint64_t* sequence, uint64_t length, const uint32_t* dwell = nullptr);
+
+	// Arms a sequence of number_of_frames frames, starting at position 0 on the next vsync.
+	// Queued, fails if the queue is full.
+	bool Start(int number_of_frames);
+
+	// Moves to a position of the order on the next vsync, outside of a sequence. Queued.
+	bool SetFrame(uint64_t position);
+
+	// Moves to a position, clamped to the order (for the debug controls). Presenter thread only.
+	void SetFrameIndex(int64_t position);
+
+	// Stops advancing positions until the next sequence starts. Queued.
+	void Hold();
+
+	// Consistent copy of the state as of the last BeginFrame or EndFrame, from any thread
+	SequencerStatus Status() const;
+
+	// True if the vsync about to start ends the running sequence
+	bool SequenceDone() const { return frames_to_play < 0 && active; };
+
+	// Applies queued commands, ends a finished sequence and arms a freshly started one, before drawing
+	void BeginFrame();
+
+	// Slot to show on this vsync
+	uint64_t Slot() const { return order.empty() ? 0 : order[frame_index % order.size()]; };
+
+	// Advances after the present. Returns true when the first frame of a sequence went out.
+	bool EndFrame();
+
+	// Live state, for the presenter's thread
+	SequencerMode Mode() const { return mode; };
+	bool IsActive() const { return active; };
+	bool CameraTrigger() const { return camera_trigger; };
+	int FramesToPlay() const { return frames_to_play; };
+	int FramesInSequence() const { return frames_in_sequence; };
+	int64_t FrameIndex() const { return frame_index; };
+	int64_t BufferIndex() const { return buffer_index; };
+	const std::vector<uint64_t>& Order() const { return order; };
+	uint32_t Dwell(uint64_t position) const { return dwell.empty() ? 1 : dwell[position % dwell.size()]; };
+
+private:
+	enum CommandType { COMMAND_SET_ORDER, COMMAND_START, COMMAND_SET_FRAME, COMMAND_HOLD };
+	struct Command {
+		CommandType type;
+		int64_t value;
+		std::unique_ptr<std::vector<uint64_t>> order;  // COMMAND_SET_ORDER only
+		std::unique_ptr<std::vector<uint32_t>> dwell;  // COMMAND_SET_ORDER, null for no dwell counts
+	};
+
+	bool Push(CommandType type, int64_t value, std::unique_ptr<std::vector<uint64_t>> new_order = nullptr,
+		std::unique_ptr<std::vector<uint32_t>> new_dwell = nullptr);
+	uint64_t QueuedPositions();
+	uint64_t ApplyCommands();
+	void Publish();
+
+	std::vector<uint64_t> order;
+	std::vector<uint32_t> dwell;           // Vsyncs per position, empty when every position is shown once
+	uint64_t num_slots = 0;
+
+	SequencerMode mode = SEQUENCER_IDLE;
+	bool active = false;
+	bool first_frame_trigger = false;      // Set until the first frame of a sequence is shown
+	bool start_pending = false;            // Started, position 0 not drawn yet
+	bool starting = false;                 // Position 0 drawn, not presented yet
+	bool camera_trigger = false;
+	int frames_to_play = 0;
+	int frames_in_sequence = -1;
+	int64_t frame_index = 0;
+	uint32_t held = 0;                     // Vsyncs frame_index has been shown for during a sequence
+	int64_t buffer_index = -1;             // -1 signals that no sequence is being presented
+	uint64_t vsync = 0;
+
+	// Single-consumer ring of commands. Producers are serialised by push_mutex, which the
+	// presenter never takes.
+	Command commands[SEQUENCER_QUEUE_SIZE];
+	std::atomic<uint64_t> command_head{ 0 };   // Next command to apply, stored once its effect is published
+	std::atomic<uint64_t> command_tail{ 0 };   // Next free entry
+	std::mutex push_mutex;
+	uint64_t order_command = 0;                // One past the last queued SetOrder
+	uint64_t order_length = 0;                 // and its length
+
+	// Seqlock over the published status: odd while it's being written
+	static constexpr size_t STATUS_WORDS = (sizeof(SequencerStatus) + 7) / 8;
+	std::atomic<uint64_t> status_sequence{ 0 };
+	std::atomic<uint64_t> status_words[STATUS_WORDS];
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+// x86 intrinsics for the vectorised kernels. Kernels are compiled per function for the ISA
+// they need (PLM_TARGET) and picked at runtime with DetectBitpackISA, so the rest of the
+// library still runs on any x86-64 CPU.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PLM_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PLM_TARGET(isa)
+#else
+#include <cpuid.h>
+#define PLM_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
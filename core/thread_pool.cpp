@@ -0,0 +1,167 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+ThreadPool::~ThreadPool() {
+	// At process exit the workers are already gone and join returns straight away
+	Shutdown();
+}
+
+void ThreadPool::Resize(unsigned int num_threads) {
+
+	if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::lock_guard<std::mutex> job_lock(job_mutex);
+	if (started && num_threads == Size()) return;
+
+	Stop();
+
+	uint64_t current_generation = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current_generation = generation;
+	}
+
+	for (unsigned int w = 0; w + 1 < num_threads; w++) {
+		workers.emplace_back([this, w, current_generation]() {
+			uint64_t seen = current_generation;
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true) {
+				job_ready.wait(lock, [&]() { return quit || generation != seen; });
+				if (quit) {
+					// Nothing of the pool is used after this, Release relies on it
+					lock.unlock();
+					workers_left++;
+					return;
+				};
+				seen = generation;
+
+				lock.unlock();
+				RunChunks();
+				lock.lock();
+
+				if (--busy_workers == 0) job_done.notify_one();
+			};
+		});
+		ApplyAffinity(w);
+	};
+
+	started = true;
+}
+
+void ThreadPool::Shutdown() {
+	std::lock_guard<std::mutex> job_lock(job_mutex);
+	Stop();
+}
+
+void ThreadPool::Release() {
+	std::lock_guard<std::mutex> job_lock(job_mutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	job_ready.notify_all();
+	while (workers_left.load() < workers.size()) std::this_thread::yield();
+	for (auto& worker : workers) worker.detach();
+	workers.clear();
+	workers_left = 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	quit = false;
+	started = false;
+}
+
+void ThreadPool::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	job_ready.notify_all();
+	for (auto& worker : workers) worker.join();
+	workers.clear();
+	workers_left = 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	quit = false;
+	started = false;
+}
+
+void ThreadPool::SetAffinity(bool pin) {
+	std::lock_guard<std::mutex> job_lock(job_mutex);
+	pinned = pin;
+	for (unsigned int w = 0; w < workers.size(); w++) ApplyAffinity(w);
+}
+
+void ThreadPool::ApplyAffinity(unsigned int index) {
+
+	const unsigned int cpus = std::max(1u, std::thread::hardware_concurrency());
+	const unsigned int cpu = (index + 1) % cpus;
+
+#ifdef _WIN32
+	DWORD_PTR process_mask = 0, system_mask = 0;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) return;
+	DWORD_PTR mask = process_mask;
+	if (pinned && cpu < sizeof(DWORD_PTR) * 8 && (process_mask & ((DWORD_PTR)1 << cpu))) {
+		mask = (DWORD_PTR)1 << cpu;
+	};
+	SetThreadAffinityMask((HANDLE)workers[index].native_handle(), mask);
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (pinned) {
+		CPU_SET(cpu, &set);
+	} else {
+		for (unsigned int c = 0; c < cpus; c++) CPU_SET(c, &set);
+	};
+	pthread_setaffinity_np(workers[index].native_handle(), sizeof(set), &set);
+#else
+	(void)cpu;
+#endif
+}
+
+void ThreadPool::RunChunks() {
+	while (true) {
+		uint64_t begin = next_chunk.fetch_add(1) * chunk_size;
+		if (begin >= job_count) break;
+		uint64_t end = std::min(begin + chunk_size, job_count);
+		(*job)(begin, end);
+	};
+}
+
+void ThreadPool::ParallelFor(uint64_t count, const std::function<void(uint64_t, uint64_t)>& fn) {
+
+	if (count == 0) return;
+
+	std::lock_guard<std::mutex> job_lock(job_mutex);
+
+	if (workers.empty() || count == 1) {
+		fn(0, count);
+		return;
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &fn;
+		job_count = count;
+		// A few chunks per thread evens out threads that get descheduled
+		chunk_size = std::max<uint64_t>(1, count / (4 * (uint64_t)Size()));
+		next_chunk = 0;
+		busy_workers = (unsigned int)workers.size();
+		generation++;
+	}
+	job_ready.notify_all();
+
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	job_done.wait(lock, [&]() { return busy_workers == 0; });
+	job = nullptr;
+}
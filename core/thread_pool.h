@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads for the CPU bitpacking paths.
+//
+// Workers are created once (Resize) and sleep on a condition variable between jobs,
+// so splitting a frame between them costs a wake-up rather than thread creation.
+// ParallelFor is blocking and the calling thread takes chunks as well. Jobs from
+// different caller threads run one after the other. Don't call ParallelFor from
+// inside a job. The destructor joins the workers.
+
+class ThreadPool {
+public:
+	ThreadPool() = default;
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Total number of threads working on a job, caller included. 0 uses every hardware thread.
+	void Resize(unsigned int num_threads);
+	unsigned int Size() const { return (unsigned int)workers.size() + 1; };
+	bool IsStarted() const { return started.load(); };
+
+	// Joins the workers, they're started again by Resize
+	void Shutdown();
+
+	// Stops the workers without joining them, for a DLL being unloaded: joining under the
+	// loader lock deadlocks, as exiting threads wait for it. Returns once no worker touches
+	// the pool any more, so it can be destroyed right after.
+	void Release();
+
+	// Pins worker w to logical processor w + 1 (the caller keeps core 0's share), or unpins them.
+	void SetAffinity(bool pin);
+	bool HasAffinity() const { return pinned; };
+
+	// Calls fn(begin, end) on disjoint chunks covering [0, count) and waits for all of them.
+	void ParallelFor(uint64_t count, const std::function<void(uint64_t, uint64_t)>& fn);
+
+private:
+	void RunChunks();
+	void Stop();
+	void ApplyAffinity(unsigned int index);
+
+	std::vector<std::thread> workers;
+	std::atomic<bool> started{ false };    // Read without job_mutex by IsStarted
+	bool pinned = false;
+
+	std::mutex job_mutex;                  // Serialises ParallelFor callers
+	std::mutex mutex;
+	std::condition_variable job_ready;
+	std::condition_variable job_done;
+	bool quit = false;
+	uint64_t generation = 0;               // Bumped for every job
+	unsigned int busy_workers = 0;
+	std::atomic<unsigned int> workers_left{ 0 };   // Workers that returned from their loop, see Release
+
+	const std::function<void(uint64_t, uint64_t)>* job = nullptr;
+	uint64_t job_count = 0;
+	uint64_t chunk_size = 1;
+	std::atomic<uint64_t> next_chunk{ 0 };
+};
@@ -356,7 +356,9 @@ namespace PLM {
 		ID3D11SamplerState* pSamplerState,
 		ImGuiIO& io, int N, int M,
 		std::mutex* mutex,
-		int x0 = 0, int y0 = 0) {
+		int x0 = 0, int y0 = 0,
+		bool upload = true,
+		uint8_t blank_fill = 255) {
 
 		static int imgWidth = N / 4, imgHeight = M / 4;
 
@@ -380,31 +382,45 @@ namespace PLM {
 		ImGui::Begin(title, &p_open, slm_window_flags);
 		ImGui::PopStyleVar(2);
 
-		// Update texture data
-		D3D11_MAPPED_SUBRESOURCE mapped_resource;
-		ID3D11Texture2D* pTexture = NULL;
-		data_texture_view->GetResource((ID3D11Resource**)&pTexture);
-		g_pd3dDeviceContext->Map(pTexture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_resource);
-
-		//g_pd3dDeviceContext->PSSetSamplers(0, 1, &pSamplerState);
-		//start = std::chrono::high_resolution_clock::now();
-
-		uint8_t* dest = static_cast<uint8_t*>(mapped_resource.pData);
-		uint8_t* src = static_cast<uint8_t*>(data);
-
-		for (uint64_t row = 0; row < M; ++row) {
-			// Copy each row, taking into account the pitch
-			memcpy(dest + row * mapped_resource.RowPitch,
-				src + row * N * 4 * sizeof(uint8_t),
-				(uint64_t) N * 4 * sizeof(uint8_t));
-		}
+		// Update texture data. Dynamic textures keep their contents, so when the frame
+		// hasn't changed we skip the copy and show the texture as it is.
+		if (upload) {
+			D3D11_MAPPED_SUBRESOURCE mapped_resource;
+			ID3D11Texture2D* pTexture = NULL;
+			data_texture_view->GetResource((ID3D11Resource**)&pTexture);
+			g_pd3dDeviceContext->Map(pTexture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_resource);
+
+			//g_pd3dDeviceContext->PSSetSamplers(0, 1, &pSamplerState);
+			//start = std::chrono::high_resolution_clock::now();
+
+			uint8_t* dest = static_cast<uint8_t*>(mapped_resource.pData);
+			uint8_t* src = static_cast<uint8_t*>(data);
+
+			if (src == nullptr) {
+				// Blank slot: every RGB byte is blank_fill, the store isn't touched
+				static std::vector<uint8_t> blank_row;
+				blank_row.assign(4 * (uint64_t)N, blank_fill);
+				for (uint64_t texel = 0; texel < (uint64_t)N; ++texel) blank_row[4 * texel + 3] = 255;
+				for (uint64_t row = 0; row < M; ++row) {
+					std::memcpy(dest + row * mapped_resource.RowPitch, blank_row.data(), blank_row.size());
+				}
+			} else {
+				for (uint64_t row = 0; row < M; ++row) {
+					// Frames are stored as packed RGB, expand each row to RGBA taking into account the pitch.
+					// The mapped texture is write-only, so the rows are streamed.
+					ExpandRGBToRGBA(src + row * N * FRAME_STORE_TEXEL_BYTES,
+						dest + row * mapped_resource.RowPitch,
+						(uint64_t) N, true);
+				}
+			}
 
-		g_pd3dDeviceContext->Unmap(pTexture, 0);
-		pTexture->Release();
+			g_pd3dDeviceContext->Unmap(pTexture, 0);
+			pTexture->Release();
 
-		//end = std::chrono::high_resolution_clock::now();
-		//std::chrono::duration<double> elapsed = end - start;
-		//std::cout << "Elapsed time: " << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " us" << std::endl;
+			//end = std::chrono::high_resolution_clock::now();
+			//std::chrono::duration<double> elapsed = end - start;
+			//std::cout << "Elapsed time: " << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << " us" << std::endl;
+		};
 
 		static ImVec2 ulim = ImVec2(0.0f, 1.0f);
 		static ImVec2 vlim = ImVec2(0.0f, 1.0f);
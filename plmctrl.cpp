@@ -40,6 +40,7 @@
 #include "imgui/imgui_impl_dx11.h"
 #include <d3d11.h>
 #include <d3dcompiler.h>
+#include <d3d11shader.h>
 #include <tchar.h>
 
 #define WIN32_LEAN_AND_MEAN  // Exclude rarely-used stuff from Windows headers
@@ -48,11 +49,23 @@
 #include <stdio.h>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <functional>
 #include <vector>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
 #include <iostream>
 
+#include "core/plm_core.h"
+#include "core/headless_presenter.h"
+
 #include "PLM/PLM.h"
 #include "plmctrl.h"
 
@@ -80,24 +93,60 @@ static ID3D11ShaderResourceView* g_pPhaseSRV = nullptr;
 static ID3D11ShaderResourceView* g_pLUTSRV = nullptr;
 static ID3D11ShaderResourceView* g_pPhaseMapSRV = nullptr;
 
+// Integer input (pre-quantised levels or fixed-point phases) in a raw buffer, read by the
+// integer_main entry point. Fixed-point phases go through the quantiser's level table.
+static ID3D11ComputeShader* g_pIntegerShader = nullptr;
+static ID3D11ComputeShader* g_pPlaneShader = nullptr;
+static ID3D11Buffer* g_pIntegerInputBuffer = nullptr;
+static ID3D11ShaderResourceView* g_pIntegerInputSRV = nullptr;
+static ID3D11Buffer* g_pLevelTableBuffer = nullptr;
+static ID3D11ShaderResourceView* g_pLevelTableSRV = nullptr;
+
 static ID3D11Buffer* g_pHologramBuffer = nullptr;
 static ID3D11UnorderedAccessView* g_pHologramUAV = nullptr;
 ID3D11Texture2D* pHologramTexture = nullptr;
 ID3D11Texture2D* pStagingTexture;
 
 
-// 16 bytes
+// 32 bytes, has to match cbuffer Constants in BitpackHologramsCS.hlsl (checked when the shaders are compiled)
 struct c_Params {
 	uint32_t N;
 	uint32_t M;
 	uint32_t num_holograms;
-	uint32_t pad;
+	uint32_t input_format;
+	// main only: phase element (i, j, n) is phase[phase_offset + i * pixel_stride + j * row_stride + n * plane_stride]
+	int32_t pixel_stride;
+	int32_t row_stride;
+	int32_t plane_stride;
+	int32_t phase_offset;
+};
+
+// Constants for N x M x num_holograms phases stored row-major from the start of the phase buffer
+static c_Params BitpackConstants(unsigned long long N, unsigned long long M, int num_holograms) {
+	c_Params constant = {};
+	constant.N = (uint32_t)N;
+	constant.M = (uint32_t)M;
+	constant.num_holograms = (uint32_t)num_holograms;
+	constant.pixel_stride = 1;
+	constant.row_stride = (int32_t)N;
+	constant.plane_stride = (int32_t)(N * M);
+	return constant;
+}
+
+// What integer_main reads from the integer input buffer
+enum IntegerInput {
+	INTEGER_INPUT_LEVELS_U8 = LEVEL_FORMAT_U8,
+	INTEGER_INPUT_LEVELS_NIBBLE = LEVEL_FORMAT_NIBBLE,
+	INTEGER_INPUT_PHASE_U8 = 2,
+	INTEGER_INPUT_PHASE_U16 = 3,
 };
 
 
-bool running = false;
+std::atomic<bool> running = false;
 bool isSetupDone = false;
 uint8_t* plm_image_ptr = nullptr;
+uint64_t texture_uploads = 0;          // Frames copied into the display texture
+uint64_t texture_uploads_skipped = 0;  // Vsyncs that kept the texture as it was
 
 std::mutex mutex;
 std::mutex plm_image_mutex;
@@ -108,35 +157,16 @@ int N = 200, M = 200, monitor_id = 0;
 int window_x0 = 0, window_y0 = 0;
 int delay = 200;
 
-enum PLM_MODE {
-	PLM_IDLE = 0,
-	PLM_PLAYING = 1,
-	PLM_CONTINUOUS = 2
-};
-
-PLM_MODE plm_mode = PLM_IDLE;
-
 bool plm_connected = false;
 bool plm_monitoring_status = false;
-bool first_frame_trigger = false;
-bool start_playing_trigger = false;
 bool plm_is_displaying = false;
-bool sequence_active = false;
 bool displaying_active = false;
 bool continuous_mode = false;
-std::atomic<bool> pause_UI = false;
-std::atomic<bool> bitpacking_in_progress = false;
-std::atomic<bool> UI_is_rendering = false;
 
 
 
-int frames_to_play = 0;
-int frames_in_sequence = -1;
-int64_t frame_index = 0;
-int64_t buffer_index = -1;
 long long t0 = 0;
 
-bool camera_trigger = false;
 bool show_debug_window = true;
 
 RECT monitorRect;
@@ -144,37 +174,137 @@ RECT monitorRect;
 std::chrono::duration<double> elapsed_content;
 std::chrono::duration<double> elapsed_buffer;
 std::chrono::duration<double> elapsed_total;
+std::chrono::high_resolution_clock::time_point ui_start_requested;   // Set by StartUI
+std::chrono::duration<double> startup_latency{ 0 };                   // StartUI to the first present
 
 uint64_t MAX_FRAMES = 64;
 bool windowed = false;
-std::vector<unsigned char> frame;
-std::vector<uint8_t> frame_set;
-std::vector<uint64_t> frame_order;
+// One pipeline behind a plm_handle: lookup-table, phase map, CPU packer, frame store (packed RGB,
+// expanded to RGBA on upload), sequencer and a headless presenter. The window and the D3D11
+// device are shared, they present and GPU-pack for one instance at a time.
+struct plm_instance {
+	PLMCore core;
+	HeadlessPresenter presenter{ core.Frames(), core.Sequence() };
+	std::vector<uint8_t> gpu_frame;    // Level readback for UpdateHologramPlaneGPU
+};
+
+// The original exports are thin adapters over the default instance
+plm_instance default_instance;
+plm_instance* ui_instance = &default_instance;   // Instance shown in the window
 
 std::mutex dx_mutex;
 
-// TI's default lookup-table
-float phases[17] = { 0, 0.0100, 0.0205, 0.0422, 0.0560, 0.0727, 0.1131, 0.1734, 0.3426, 0.3707, 0.4228, 0.4916, 0.5994, 0.6671, 0.7970, 0.9375, 1.0 };
-
-// Binary counting phase-map, has to be calibrated.
-int phase_map[] = {
-	0, 0, 0, 0,
-	1, 0, 0, 0,
-	0, 1, 0, 0,
-	1, 1, 0, 0,
-	0, 0, 1, 0,
-	1, 0, 1, 0,
-	0, 1, 1, 0,
-	1, 1, 1, 0,
-	0, 0, 0, 1,
-	1, 0, 0, 1,
-	0, 1, 0, 1,
-	1, 1, 0, 1,
-	0, 0, 1, 1,
-	1, 0, 1, 1,
-	0, 1, 1, 1,
-	1, 1, 1, 1
+// State of the render loop, see RenderWait
+enum RenderState {
+	RENDER_IDLE = 0,        // No UI loop running
+	RENDER_PLAYING = 1,     // Presenting every vsync
+	RENDER_PAUSED = 2,      // Blocked until ResumeUI, running queued commands only
+	RENDER_DRAINING = 3,    // A sequence ended, waiting delay ms before stopping the PLM
 };
+std::atomic<int> render_state{ RENDER_IDLE };
+
+// Commands for the render thread (GPU packing, frame-store resizes), run between two presents
+// so they never race the frame upload or the device context. render_mutex also guards the
+// pause request, and render_wakeup wakes a waiting render loop for either.
+std::mutex render_mutex;
+std::condition_variable render_wakeup;
+std::deque<std::packaged_task<bool()>> render_queue;
+bool render_queue_open = false;          // Set from LaunchUI until the UI loop ends
+bool pause_requested = false;
+std::thread::id render_thread_id;
+
+// ResumeUI to the next present, in ms
+std::chrono::steady_clock::time_point resume_requested;
+std::atomic<bool> resume_pending = false;
+// Written by the render loop under render_mutex
+double resume_latency_last = 0.0;
+double resume_latency_worst = 0.0;
+
+// Runs command on the render thread and waits for its result. From the loop itself it runs right
+// away. Without a UI, commands that use the device fail, since the device only lives on the UI
+// thread, and the others run on the calling thread.
+static bool RunOnRenderThread(std::function<bool()> command, bool uses_device = true) {
+	std::packaged_task<bool()> task(std::move(command));
+	std::future<bool> result = task.get_future();
+	bool queued = false;
+	{
+		std::lock_guard<std::mutex> lock(render_mutex);
+		if (render_queue_open && std::this_thread::get_id() != render_thread_id) {
+			render_queue.push_back(std::move(task));
+			queued = true;
+		} else if (!render_queue_open && uses_device) {
+			return false;
+		};
+	}
+	if (queued) render_wakeup.notify_all();
+	else task();
+	return result.get();
+}
+
+static void RunRenderCommands() {
+	std::deque<std::packaged_task<bool()>> commands;
+	{
+		std::lock_guard<std::mutex> lock(render_mutex);
+		commands.swap(render_queue);
+	}
+	for (auto& command : commands) command();
+}
+
+// Called before the UI thread starts. Commands sent while the window and device come up are
+// queued, and run once the loop opens the queue.
+static void PrepareRenderQueue() {
+	std::lock_guard<std::mutex> lock(render_mutex);
+	render_queue_open = true;
+	render_thread_id = std::thread::id();
+}
+
+static void OpenRenderQueue() {
+	std::lock_guard<std::mutex> lock(render_mutex);
+	render_thread_id = std::this_thread::get_id();
+	render_state = RENDER_PLAYING;
+}
+
+// Later device commands fail, the others run on their callers' threads. The ones already queued
+// run here, while the device is still up.
+static void CloseRenderQueue() {
+	{
+		std::lock_guard<std::mutex> lock(render_mutex);
+		render_queue_open = false;
+		render_state = RENDER_IDLE;
+	}
+	RunRenderCommands();
+}
+
+// Blocks the render loop until deadline, and for as long as the UI is paused, running queued
+// commands as they come in. Returns straight away (after the commands) when there's nothing to
+// wait for, or when the UI is stopped.
+static void RenderWait(std::chrono::steady_clock::time_point deadline) {
+	std::unique_lock<std::mutex> lock(render_mutex);
+	while (running) {
+		if (!render_queue.empty()) {
+			lock.unlock();
+			RunRenderCommands();
+			lock.lock();
+			continue;
+		};
+		if (pause_requested) {
+			render_state = RENDER_PAUSED;
+			render_wakeup.wait(lock);
+			continue;
+		};
+		if (std::chrono::steady_clock::now() >= deadline) break;
+		render_wakeup.wait_until(lock, deadline);
+	};
+	render_state = RENDER_PLAYING;
+}
+
+// Wakes the render loop to notice a pause, resume or stop
+static void WakeRenderLoop() {
+	{
+		std::lock_guard<std::mutex> lock(render_mutex);
+	}
+	render_wakeup.notify_all();
+}
 
 std::thread ui_thread;
 std::thread plm_status_thread;
@@ -188,7 +318,47 @@ void CleanupRenderTarget();
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 void DebugWindow(bool show, ImGuiIO& io);
 
-bool CompileComputeShader(ID3D11Device* device)
+// Checks the compiled shader's cbuffer Constants against c_Params. A stale copy of
+// BitpackHologramsCS.hlsl still compiles, but would read its strides from the wrong place.
+static bool CheckBitpackConstants(ID3DBlob* blob, const char* entry_point)
+{
+	ID3D11ShaderReflection* reflection = nullptr;
+	if (FAILED(D3DReflect(blob->GetBufferPointer(), blob->GetBufferSize(), IID_ID3D11ShaderReflection, (void**)&reflection))) {
+		std::cerr << "Failed to reflect compute shader " << entry_point << std::endl;
+		return false;
+	};
+
+	struct Field { const char* name; size_t offset; };
+	static const Field fields[] = {
+		{ "N", offsetof(c_Params, N) }, { "M", offsetof(c_Params, M) },
+		{ "num_holograms", offsetof(c_Params, num_holograms) }, { "input_format", offsetof(c_Params, input_format) },
+		{ "pixel_stride", offsetof(c_Params, pixel_stride) }, { "row_stride", offsetof(c_Params, row_stride) },
+		{ "plane_stride", offsetof(c_Params, plane_stride) }, { "phase_offset", offsetof(c_Params, phase_offset) },
+	};
+
+	bool matches = true;
+	ID3D11ShaderReflectionConstantBuffer* constants = reflection->GetConstantBufferByName("Constants");
+	D3D11_SHADER_BUFFER_DESC buffer_desc = {};
+	// Entry points that don't read the constants don't have the buffer
+	if (SUCCEEDED(constants->GetDesc(&buffer_desc))) {
+		matches = buffer_desc.Size == sizeof(c_Params);
+		for (const Field& field : fields) {
+			D3D11_SHADER_VARIABLE_DESC variable_desc = {};
+			if (FAILED(constants->GetVariableByName(field.name)->GetDesc(&variable_desc)) || variable_desc.StartOffset != field.offset) {
+				matches = false;
+			};
+		};
+	};
+	reflection->Release();
+
+	if (!matches) {
+		std::cerr << "BitpackHologramsCS.hlsl (" << entry_point << ") doesn't match this plmctrl build, its constants differ from c_Params. "
+			<< "Copy the shader from the repository next to the DLL." << std::endl;
+	};
+	return matches;
+}
+
+bool CompileComputeShader(ID3D11Device* device, const char* entry_point, ID3D11ComputeShader** shader)
 {
 	ID3DBlob* pBlob = nullptr;
 	ID3DBlob* pErrorBlob = nullptr;
@@ -197,7 +367,7 @@ bool CompileComputeShader(ID3D11Device* device)
 		L"BitpackHologramsCS.hlsl",
 		nullptr,
 		nullptr,
-		"main",
+		entry_point,
 		"cs_5_0",
 		0,
 		0,
@@ -218,11 +388,17 @@ bool CompileComputeShader(ID3D11Device* device)
 		return false;
 	}
 
+	if (!CheckBitpackConstants(pBlob, entry_point))
+	{
+		pBlob->Release();
+		return false;
+	}
+
 	hr = device->CreateComputeShader(
 		pBlob->GetBufferPointer(),
 		pBlob->GetBufferSize(),
 		nullptr,
-		&g_pComputeShader
+		shader
 	);
 
 	if (pBlob->GetBufferSize() == 0)
@@ -321,6 +497,38 @@ bool InitBitpackResources()
 	srvDesc.BufferEx.NumElements = 64;
 	hr = g_pd3dDevice->CreateShaderResourceView(g_pPhaseMapBuffer, &srvDesc, &g_pPhaseMapSRV);
 
+	// Integer input buffer, two bytes per element at most (uint16 phases), read as 32-bit words by the shader
+	bufDesc = {};
+	bufDesc.ByteWidth = (sizeof(uint16_t) * N * M * max_num_holograms + 3) & ~3u;
+	bufDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bufDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	hr = g_pd3dDevice->CreateBuffer(&bufDesc, nullptr, &g_pIntegerInputBuffer);
+
+	srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+	srvDesc.BufferEx.FirstElement = 0;
+	srvDesc.BufferEx.NumElements = bufDesc.ByteWidth / 4;
+	srvDesc.BufferEx.Flags = D3D11_BUFFEREX_SRV_FLAG_RAW;
+	if (SUCCEEDED(hr)) hr = g_pd3dDevice->CreateShaderResourceView(g_pIntegerInputBuffer, &srvDesc, &g_pIntegerInputSRV);
+
+	// Level table of the fixed-point phases, one byte per uint16 value
+	bufDesc = {};
+	bufDesc.ByteWidth = 65536;
+	bufDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bufDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	if (SUCCEEDED(hr)) hr = g_pd3dDevice->CreateBuffer(&bufDesc, nullptr, &g_pLevelTableBuffer);
+
+	srvDesc.BufferEx.NumElements = bufDesc.ByteWidth / 4;
+	if (SUCCEEDED(hr)) hr = g_pd3dDevice->CreateShaderResourceView(g_pLevelTableBuffer, &srvDesc, &g_pLevelTableSRV);
+	if (FAILED(hr)) {
+		// Only the integer input is unavailable on the GPU
+		std::cout << "Failed to create integer input buffers with HRESULT: 0x" << std::hex << hr << std::dec << std::endl;
+	};
+
 	// Hologram buffer for output (corrected to match output size)
 	D3D11_TEXTURE2D_DESC texDesc = {};
 	texDesc.Width = 2 * N;
@@ -423,27 +631,39 @@ int Close() {return PLM::Close();};
 
 
 bool PauseUI() {
-	pause_UI = true;
+	{
+		std::lock_guard<std::mutex> lock(render_mutex);
+		pause_requested = true;
+	}
+	render_wakeup.notify_all();
 	return true;
 };
 
 bool ResumeUI() {
-	pause_UI = false;
+	{
+		std::lock_guard<std::mutex> lock(render_mutex);
+		if (pause_requested) {
+			resume_requested = std::chrono::steady_clock::now();
+			resume_pending = true;
+		};
+		pause_requested = false;
+	}
+	// The loop presents on the next vsync
+	render_wakeup.notify_all();
 	return true;
 };
 
-bool StartSequence(int number_of_frames) {
-
-	if (number_of_frames > MAX_FRAMES) {
-		return false;
-	};
+int GetUIState() {
+	return render_state.load();
+};
 
-	frames_to_play = number_of_frames;
-	frames_in_sequence = number_of_frames;
-	sequence_active = true;
-	first_frame_trigger = true;
+double GetResumeLatency() {
+	std::lock_guard<std::mutex> lock(render_mutex);
+	return resume_latency_last;
+};
 
-	return true;
+bool StartSequence(int number_of_frames) {
+	return PLM_StartSequence(&default_instance, number_of_frames);
 }
 
 
@@ -454,7 +674,7 @@ bool StartDisplaying() {
 	// IN CONSTRUCTION
 
 	displaying_active = true;
-	first_frame_trigger = true;
+	ui_instance->core.Sequence().Hold();
 
 	return true;
 }
@@ -467,6 +687,10 @@ bool Resynchronise(unsigned long long offset) {
 // Main code
 int UI(){
 
+	// Instance shown in the window, fixed while the UI runs
+	FrameStore& frame_set = ui_instance->core.Frames();
+	Sequencer& sequencer = ui_instance->core.Sequence();
+
 	//if (!GetSecondMonitorRect(monitorRect, monitor_id)) {
 	//	std::cerr << "Second monitor not found!" << std::endl;
 	//	return 1;
@@ -495,6 +719,8 @@ int UI(){
 	if (!CreateDeviceD3D(hwnd))
 	{
 		CleanupDeviceD3D();
+		// Commands queued since LaunchUI find no resources and fail
+		CloseRenderQueue();
 		::UnregisterClassW(wc.lpszClassName, wc.hInstance);
 		return 1;
 	}
@@ -578,28 +804,30 @@ int UI(){
 
 	timepoint now;
 	bool done = false;
+
+	// Slot and generation the display texture currently holds, a fresh texture holds nothing
+	uint64_t uploaded_slot = UINT64_MAX;
+	uint64_t uploaded_generation = 0;
+
+	bool first_present = true;
+
+	OpenRenderQueue();
+
 	// Main UI loop. Changes the frames with VSync enabled
 	while (running && !done)
 	{
-		UI_is_rendering.store(false);
-		if (bitpacking_in_progress.load() || pause_UI.load()) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(100));
-			continue;
-		};
-		UI_is_rendering.store(true);
-
-		if (frames_to_play < 0 && sequence_active) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+		// Queued packs and resizes run between the last present and the next frame,
+		// and a paused UI blocks here until it's resumed
+		RenderWait(std::chrono::steady_clock::now());
+		if (!running) break;
+
+		if (sequencer.SequenceDone()) {
+			render_state = RENDER_DRAINING;
+			RenderWait(std::chrono::steady_clock::now() + std::chrono::milliseconds(delay));
 			// Pause Playing the sequence.
 
 			if (plm_connected)  PLM::Stop(); // This only works with INCLUDE_LIGHTCRAFTER_WRAPPERS is defined
 			plm_is_displaying = false;
-			sequence_active = false;
-
-			buffer_index = -1; // buffer_index = -1 signals that the sequence has ended
-			plm_mode = PLM_IDLE;
-
-			camera_trigger = false;
 
 			//std::cout << "Sequence finished" << std::endl;
 		};
@@ -671,19 +899,30 @@ int UI(){
 		ImGui::DockSpace(dockspace_id, ImVec2(0.0f, 0.0f), dockspace_flags);
 		ImGui::End();
 
-		static uint64_t frame_elements = 4 * (2 * N) * (2 * M);
-		if (frames_to_play == frames_in_sequence && sequence_active) {
-			plm_mode = PLM_PLAYING;
-			frame_index = 0;
-			first_frame_trigger = false;
-			start_playing_trigger = true;
-		}
-
-		plm_image_ptr = frame_set.data()
-			+ frame_order[frame_index % MAX_FRAMES] * frame_elements;
+		// Ends a finished sequence and rewinds to the first frame of a new one
+		sequencer.BeginFrame();
+
+		uint64_t slot = sequencer.Slot();
+		// A blank slot is uploaded as a constant, filling it here would stall the vsync
+		const bool blank_slot = frame_set.IsBlank(slot);
+		plm_image_ptr = blank_slot ? nullptr : frame_set.Frame(slot);
+
+		// Only upload when the slot or its contents changed since the last upload.
+		// The generation is read before the copy, so a concurrent insert triggers another one.
+		// A leased slot is still being written and isn't uploaded. The texture keeps whatever was
+		// uploaded last, during playback the previous slot's frame, while the status reports the leased slot.
+		uint64_t generation = frame_set.Generation(slot);
+		bool upload_frame = (plm_image_ptr != nullptr || blank_slot) && !frame_set.IsLeased(slot) && (slot != uploaded_slot || generation != uploaded_generation);
+		if (upload_frame) {
+			uploaded_slot = slot;
+			uploaded_generation = generation;
+			texture_uploads++;
+		} else {
+			texture_uploads_skipped++;
+		};
 
 		// PLM frame window
-		PLM::ImagescPLM("PLM", plm_image_ptr, data_texture_srv, g_pd3dDevice, g_pd3dDeviceContext, pSamplerState, io, 2 * N, 2 * M, &mutex, window_x0, window_y0);
+		PLM::ImagescPLM("PLM", plm_image_ptr, data_texture_srv, g_pd3dDevice, g_pd3dDeviceContext, pSamplerState, io, 2 * N, 2 * M, &mutex, window_x0, window_y0, upload_frame, frame_set.FillValue());
 
 
 		DebugWindow(show_debug_window, io);
@@ -708,22 +947,33 @@ int UI(){
 		HRESULT hr = g_pSwapChain->Present(1, 0);
 		g_SwapChainOccluded = (hr == DXGI_STATUS_OCCLUDED);
 
+		if (resume_pending.exchange(false)) {
+			const auto presented = std::chrono::steady_clock::now();
+			std::lock_guard<std::mutex> lock(render_mutex);
+			resume_latency_last = std::chrono::duration<double, std::milli>(presented - resume_requested).count();
+			resume_latency_worst = std::max(resume_latency_worst, resume_latency_last);
+		};
+
+		if (first_present) {
+			startup_latency = std::chrono::high_resolution_clock::now() - ui_start_requested;
+			std::cout << "[plmctrl]: First frame presented " << startup_latency.count() * 1000 << " ms after StartUI" << std::endl;
+			first_present = false;
+		};
+
 		end = std::chrono::high_resolution_clock::now();
 		elapsed_content = end - start;
 		start = std::chrono::high_resolution_clock::now();
-		buffer_index = camera_trigger ? buffer_index + 1 : -1;
+		// Advances the sequence, true when the first frame of a sequence was just presented
+		bool sequence_started = sequencer.EndFrame();
 
-
-		if (plm_mode == PLM_PLAYING && frames_to_play == frames_in_sequence) {
-			camera_trigger = true;
-			buffer_index = 0;
+		if (sequence_started) {
 			t0 = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
 			//std::cout << "[plmctrl]: First frame trigger" << std::endl;
 			PLM::Play(); // This only works if LightCrafter wrappers are included
 
 		};
-		//if (plm_mode == PLM_PLAYING) {
-		//	std::cout << "[plmctrl]: Buffer Index on plmctrl: " << buffer_index << std::endl;
+		//if (sequencer.Mode() == SEQUENCER_PLAYING) {
+		//	std::cout << "[plmctrl]: Buffer Index on plmctrl: " << sequencer.BufferIndex() << std::endl;
 		//}
 
 		end = std::chrono::high_resolution_clock::now();
@@ -732,17 +982,10 @@ int UI(){
 		end_total = std::chrono::high_resolution_clock::now();
 		elapsed_total = end_total - start_total;
 
-		// first_frame_trigger is a variable to know exactly that the first frame was already sent to the GPU buffer queue. 
-		if (frames_to_play >= 0 && !(first_frame_trigger)) {
-			frame_index++;
-			frame_index = clamp(frame_index, 0, MAX_FRAMES - 1);
-			frames_to_play--;
-		};
-
-		UI_is_rendering.store(false);
-
 	};
 
+	// The device is still up for commands that were queued before the loop ended
+	CloseRenderQueue();
 
 	// Cleanup
 	ImGui_ImplDX11_Shutdown();
@@ -761,28 +1004,19 @@ int UI(){
 	return 0;
 }
 
-void StartUI(unsigned int number_of_frames) {
-
-	MAX_FRAMES = number_of_frames;
-
-	frame_order.resize(MAX_FRAMES);
-	for (int i = 0; i < MAX_FRAMES; i++) {
-		frame_order[i] = i;
-	};
+// Starts the window, presenting instance
+static void LaunchUI(plm_instance* instance) {
 
 	if (running) {
 		StopUI();
-		StartUI(number_of_frames);
-		return;
 	};
 
+	ui_instance = instance;
+	MAX_FRAMES = instance->core.Frames().NumFrames();
+
 	running = true;
 	plm_image_ptr = nullptr;
-
-	frame.resize(4 * (2 * N) * (2 * M));
-	frame_set.resize(4 * (2 * N) * (2 * M) * MAX_FRAMES);
-	std::fill(frame_set.begin(), frame_set.end(), 255);
-
+	PrepareRenderQueue();
 
 #ifndef PLM_DEBUG
 	std::cout << "Starting UI thread" << std::endl;
@@ -794,6 +1028,21 @@ void StartUI(unsigned int number_of_frames) {
 	return;
 }
 
+void StartUI(unsigned int number_of_frames) {
+
+	ui_start_requested = std::chrono::high_resolution_clock::now();
+	if (running) {
+		StopUI();
+	};
+
+	default_instance.core.ResetFrames(N, M, number_of_frames);
+	LaunchUI(&default_instance);
+}
+
+bool ResizeFrameStore(unsigned long long num_frames) {
+	return PLM_ResizeFrameStore(&default_instance, num_frames);
+}
+
 void ResetUI() {
 	running = false;
 	StopUI();
@@ -804,6 +1053,7 @@ void StopUI() {
 
 	isSetupDone = false;
 	running = false;
+	WakeRenderLoop();
 	plm_image_ptr = nullptr;
 	ui_thread.join();
 
@@ -827,117 +1077,58 @@ void SetPLMWindowPos(int width, int height, int x0 = 0, int y0 = 0 ) {
 };
 
 
+void SetBitpackThreads(unsigned int num_threads) {
+	PLM_SetBitpackThreads(&default_instance, num_threads);
+}
+
+void SetBitpackAffinity(bool pin) {
+	PLM_SetBitpackAffinity(&default_instance, pin);
+}
+
 void SetLookupTable(float* lut) {
-	for (int i = 0; i < 17; i++) {
-		phases[i] = lut[i];
-	}
+	PLM_SetLookupTable(&default_instance, lut);
 }
 
 bool SetPhaseMap(int* new_phase_map) {
-	const int phase_map_size = 16 * 4;
-	for (int i = 0; i < phase_map_size; i++) {
-		phase_map[i] = new_phase_map[i];
-	};
-	return true;
+	return PLM_SetPhaseMap(&default_instance, new_phase_map);
 }
 
 bool SetFrameSequence(unsigned long long* sequence, unsigned long long length) {
+	return PLM_SetFrameSequence(&default_instance, sequence, length);
+};
 
-	if (length > MAX_FRAMES) {
-		return false;
-	};
-
-	for (int i = 0; i < length; i++) {
-		frame_order[i] = sequence[i];
-	};
-
-	return true;
+bool SetFrameSequenceDwell(unsigned long long* sequence, unsigned int* dwell, unsigned long long length) {
+	return PLM_SetFrameSequenceDwell(&default_instance, sequence, dwell, length);
 };
 
 bool InsertPLMFrame(unsigned char* frame, unsigned long long num_frames = 1, unsigned long long offset = 0, int type = 0) {
-
 	// Type: 0 - RGB;
 	// Type: 1 - RGBA;
+	return PLM_InsertFrames(&default_instance, frame, num_frames, offset, type);
+};
 
-	if (offset + num_frames > MAX_FRAMES) {
-		// Exceeds the maximum number of frames we can store
-		return false;
-	};
-
-	//std::cout << "Inserting " << num_frames << " frames at offset " << offset << std::endl;
-
-	uint64_t rgb_elements = (2 * N) * (2 * M);
-	uint64_t frame_elements = 4 * rgb_elements;
-	uint64_t total_elements = num_frames * frame_elements;
-	int k = 0;
-
-	if (type == 0) {
-		//std::cout << "Type: RGB" << std::endl;
-		for (uint64_t n = 0; n < num_frames; n++) {
-			for (uint64_t i = 0; i < rgb_elements; i++) {
-				frame_set.at(4 * i + (n + offset) * frame_elements + 0) = frame[3 * i + n * (3 * rgb_elements) + 0];
-				frame_set.at(4 * i + (n + offset) * frame_elements + 1) = frame[3 * i + n * (3 * rgb_elements) + 1];
-				frame_set.at(4 * i + (n + offset) * frame_elements + 2) = frame[3 * i + n * (3 * rgb_elements) + 2];
-			};
-			//std::cout << "Frame " << n << " inserted" << std::endl;
-		};
-	}
-	else if (type == 1) {
-		//std::cout << "Type: RGBA" << std::endl;
-		std::copy(
-			frame,
-			frame + total_elements,
-			frame_set.begin() + offset * frame_elements
-		);
-	};
-	//std::cout << num_frames << " frames inserted" << std::endl;
+unsigned char* AcquireFrameSlot(unsigned long long slot, unsigned long long* pitch) {
+	return PLM_AcquireFrameSlot(&default_instance, slot, pitch);
+};
 
-	return true;
+bool CommitFrameSlot(unsigned long long slot) {
+	return PLM_CommitFrameSlot(&default_instance, slot);
 };
 
 bool SetPLMFrame(unsigned long long offset = 0) {
+	return PLM_SetFrame(&default_instance, offset);
+};
 
-	if (offset >= MAX_FRAMES) {
-		// Exceeds the maximum number of holograms we can store
-		return false;
-	};
-
-	frame_index = offset;
-
-	//for (int i = 0; i < MAX_FRAMES; i++) {
-	//	frame_order[i] = offset;
-	//};
-
-	return true;
+bool GetSequenceStatus(long long* status) {
+	return PLM_GetSequenceStatus(&default_instance, status);
 };
 
 bool GrabPLMFrame(unsigned char* hologram, uint64_t index = 0) {
-
-	if (index >= MAX_FRAMES) {
-		// Exceeds the maximum number of holograms we can store
-		return false;
-	};
-
-	uint64_t frame_elements = 4 * (2 * N) * (2 * M);
-	uint64_t ptr_offset = index * frame_elements;
-
-	for (uint64_t i = 0; i < frame_elements; i++) {
-		hologram[i] = frame_set.at(i + ptr_offset);
-	};
-
-	return true;
+	return PLM_GrabFrame(&default_instance, hologram, index);
 };
 
 unsigned int QuantisePhase(float phaseVal) {
-	for (int level_num = 0; level_num < 17; level_num++) {
-		if ((phaseVal >= phases[level_num]) && (phaseVal < phases[level_num + 1])) {
-			if (fabs(phaseVal - phases[level_num]) < fabs(phaseVal - phases[level_num + 1])) {
-				return level_num;
-			};
-			return (level_num + 1) % 16;
-		}
-	}
-	return 0; // Default return if no condition is met
+	return default_instance.core.QuantisePhase(phaseVal);
 }
 
 bool BitpackHolograms(
@@ -947,114 +1138,71 @@ bool BitpackHolograms(
 	unsigned long long M,
 	int num_holograms
 ) {
-	// Check if the number of holograms is within the limit
-	if (num_holograms > 24) {
+	return PLM_BitpackHolograms(&default_instance, phase, hologram, N, M, num_holograms);
+};
+
+// GPU resources are created with the window, sized for its N x M
+static bool GPUFrameSizeMatches(unsigned long long N, unsigned long long M) {
+	if (N != (unsigned long long)::N || M != (unsigned long long)::M) {
+		std::cout << "Frame size doesn't match the PLM window" << std::endl;
 		return false;
 	};
+	return true;
+}
 
-	uint64_t phase_elements = N * M;
-
-	uint64_t holo = 0;
-	uint64_t color_id = 0;
-	uint64_t offset = 0;
-	int level = 0;
-
-	for (int n = 0; n < num_holograms; n++) {
-
-		color_id = floor(holo % 24 / 8);
-		offset = holo % 8;
-
-		for (uint64_t j = 0; j < M; j++) {
-			for (uint64_t i = 0; i < N; i++) {
-				// Quantize the phase values
-				level = QuantisePhase(phase[i + j * N + n * phase_elements]);
-				// Encode the phase values into the hologram
-				hologram[4 * (2 * i + 0) + (2 * j + 1) * (4 * 2 * N) + color_id] |= phase_map[level * 4 + 0] << offset;
-				hologram[4 * (2 * i + 0) + (2 * j + 0) * (4 * 2 * N) + color_id] |= phase_map[level * 4 + 1] << offset;
-				hologram[4 * (2 * i + 1) + (2 * j + 1) * (4 * 2 * N) + color_id] |= phase_map[level * 4 + 2] << offset;
-				hologram[4 * (2 * i + 1) + (2 * j + 0) * (4 * 2 * N) + color_id] |= phase_map[level * 4 + 3] << offset;
-
-
-				hologram[4 * (2 * i + 0) + (2 * j + 1) * (4 * 2 * N) + 3] = 255;
-				hologram[4 * (2 * i + 0) + (2 * j + 0) * (4 * 2 * N) + 3] = 255;
-				hologram[4 * (2 * i + 1) + (2 * j + 1) * (4 * 2 * N) + 3] = 255;
-				hologram[4 * (2 * i + 1) + (2 * j + 0) * (4 * 2 * N) + 3] = 255;
-			};
-		};
-		holo++;
-	}
-
+// Copies the input of a bitpacking shader into its dynamic buffer
+static bool UploadBitpackInput(ID3D11Buffer* buffer, const void* data, size_t bytes) {
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT hr = g_pd3dDeviceContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	if (FAILED(hr)) return false;
+	memcpy(mappedResource.pData, data, bytes);
+	g_pd3dDeviceContext->Unmap(buffer, 0);
 	return true;
-};
+}
 
-bool BitpackHologramsGPU(
-	float* phase,
-	unsigned char* hologram,
-	unsigned long long N,
-	unsigned long long M,
-	int num_holograms
+// Sets up a bitpacking shader with its constants, the current lookup-table and phase map, and every input
+static void BindBitpackShader(
+	const PLMCore& core,
+	ID3D11ComputeShader* shader,
+	const c_Params& constant
 )
 {
-	// Pause the UI main loop
-	bitpacking_in_progress.store(true);
-
-	//Check if UI_is_rendering is true
-	while (UI_is_rendering.load()) {
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
-		// show bitpacking_in_progress value
-		//std::cout << "Bitpacking in progress: " << bitpacking_in_progress.load() << std::endl;
-	};
-
-	// Check if the number of holograms is within the limit
-	if (num_holograms > 24) return false;
-
-	if (!phase || !hologram) {
-		std::cout << "Null pointer detected" << std::endl;
-		return false;
-	};
-
-	// Check all resources are initialized
-	if (!g_pd3dDevice || !g_pd3dDeviceContext || !g_pComputeShader ||
-		!g_pConstantBuffer || !g_pPhaseBuffer || !g_pPhaseSRV ||
-		!pHologramTexture || !g_pHologramUAV || !pStagingTexture || !g_pLUTBuffer || !g_pPhaseMapBuffer || !g_pLUTSRV) {
-		std::cout << "Resource not initialized" << std::endl;
-		return false;
-	};
-
-	// Update constant buffer 
-	c_Params constant = {};
-	constant.N = (uint32_t)N;
-	constant.M = (uint32_t)M;
-	constant.num_holograms = (uint32_t)num_holograms;
 	g_pd3dDeviceContext->UpdateSubresource(g_pConstantBuffer, 0, nullptr, &constant, 0, 0);
 
 	D3D11_BOX box;
 	// Update LUT buffer with current data 
 	box = { 0, 0, 0, (UINT)(sizeof(float) * 17), 1, 1 };
-	g_pd3dDeviceContext->UpdateSubresource(g_pLUTBuffer, 0, &box, phases, 0, 0);
+	g_pd3dDeviceContext->UpdateSubresource(g_pLUTBuffer, 0, &box, core.LookupTable(), 0, 0);
 
 	ZeroMemory(&box, sizeof(box));
 	// Update PhaseMap buffer with current data
 	box = { 0, 0, 0, (UINT)(sizeof(int) * 64), 1, 1 };
-	g_pd3dDeviceContext->UpdateSubresource(g_pPhaseMapBuffer, 0, &box, phase_map, 0, 0);
-
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	HRESULT hr_ = g_pd3dDeviceContext->Map(g_pPhaseBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (SUCCEEDED(hr_)) {
-		BYTE* pDest = reinterpret_cast<BYTE*>(mappedResource.pData);
-		size_t bufferSize = N * M * num_holograms * sizeof(float);  // Total size in bytes
-		memcpy(pDest, phase, bufferSize);
-		g_pd3dDeviceContext->Unmap(g_pPhaseBuffer, 0);
-	} else {
-		return false;
-	};
+	g_pd3dDeviceContext->UpdateSubresource(g_pPhaseMapBuffer, 0, &box, core.PhaseMap(), 0, 0);
 
-	g_pd3dDeviceContext->CSSetShader(g_pComputeShader, nullptr, 0);
+	g_pd3dDeviceContext->CSSetShader(shader, nullptr, 0);
 	g_pd3dDeviceContext->CSSetConstantBuffers(0, 1, &g_pConstantBuffer);
 	g_pd3dDeviceContext->CSSetShaderResources(0, 1, &g_pPhaseSRV);
 	g_pd3dDeviceContext->CSSetShaderResources(1, 1, &g_pLUTSRV);
 	g_pd3dDeviceContext->CSSetShaderResources(2, 1, &g_pPhaseMapSRV);
+	g_pd3dDeviceContext->CSSetShaderResources(3, 1, &g_pIntegerInputSRV);
+	g_pd3dDeviceContext->CSSetShaderResources(4, 1, &g_pLevelTableSRV);
 	g_pd3dDeviceContext->CSSetUnorderedAccessViews(0, 1, &g_pHologramUAV, nullptr);
+}
+
+// Runs a bitpacking shader on the uploaded input and reads the frame back as RGBA, or as packed
+// RGB (e.g. straight into a frame-store slot) if format is FRAME_FORMAT_RGB. Has to run on the render thread (RunOnRenderThread).
+static bool DispatchBitpack(
+	const PLMCore& core,
+	ID3D11ComputeShader* shader,
+	const c_Params& constant,
+	unsigned char* hologram,
+	FrameFormat format = FRAME_FORMAT_RGBA
+)
+{
+	const uint64_t N = constant.N;
+	const uint64_t M = constant.M;
+
+	BindBitpackShader(core, shader, constant);
 
 	g_pd3dDeviceContext->Dispatch(ceil(2.0 * N / 16.0), ceil(2.0 * M / 16.0), 1);
 
@@ -1080,39 +1228,713 @@ bool BitpackHologramsGPU(
 	uint32_t widthBytes = 2 * N * 4;                         // Width of one row in bytes (2*N pixels, 4 bytes each)
 	uint32_t height = 2 * M;                                 // Number of rows
 
-	for (uint32_t row = 0; row < height; ++row) {
-		// Copy each row, respecting the pitch of the mapped resource
-		memcpy(dest + row * widthBytes,                   // Destination offset
-			src + row * mapped.RowPitch,                  // Source offset with pitch
-			widthBytes);                                  // Bytes per row (no padding in dest)
+	if (format == FRAME_FORMAT_RGB) {
+		// Drop alpha on the way out of the mapped texture, no RGBA copy in between
+		for (uint32_t row = 0; row < height; ++row) {
+			CompactRGBAToRGB(src + row * mapped.RowPitch, dest + row * 3 * 2 * N, 2 * N, true);
+		}
+	}
+	else {
+		for (uint32_t row = 0; row < height; ++row) {
+			// Copy each row, respecting the pitch of the mapped resource
+			memcpy(dest + row * widthBytes,                   // Destination offset
+				src + row * mapped.RowPitch,                  // Source offset with pitch
+				widthBytes);                                  // Bytes per row (no padding in dest)
+		}
 	}
 
 	g_pd3dDeviceContext->Unmap(pStagingTexture, 0);
 
-	bitpacking_in_progress.store(false);
+	return true;
+}
 
+static bool BitpackResourcesReady() {
+	// Check all resources are initialized
+	if (!g_pd3dDevice || !g_pd3dDeviceContext || !g_pComputeShader ||
+		!g_pConstantBuffer || !g_pPhaseBuffer || !g_pPhaseSRV ||
+		!pHologramTexture || !g_pHologramUAV || !pStagingTexture || !g_pLUTBuffer || !g_pPhaseMapBuffer || !g_pLUTSRV) {
+		std::cout << "Resource not initialized" << std::endl;
+		return false;
+	};
 	return true;
 }
 
-bool BitpackAndInsertGPU(
-	float* phase,
+// Packs one frame with the compute shader and reads it back as RGBA. Has to run on the render thread (RunOnRenderThread).
+static bool RunBitpackShader(
+	const PLMCore& core,
+	const float* phase,
+	unsigned char* hologram,
 	unsigned long long N,
 	unsigned long long M,
 	int num_holograms,
-	unsigned long long offset	
-) {
-	if (!BitpackHologramsGPU(phase, frame.data(), N, M, num_holograms)) {
-		std::cerr << "Failed to bitpack holograms" << std::endl;
+	FrameFormat format = FRAME_FORMAT_RGBA
+)
+{
+	// Check if the number of holograms is within the limit
+	if (num_holograms > 24) return false;
+
+	if (!phase || !hologram) {
+		std::cout << "Null pointer detected" << std::endl;
 		return false;
 	};
 
-	InsertPLMFrame((unsigned char*) frame.data(), 1, offset, 1);
-	SetPLMFrame(offset);
+	if (!BitpackResourcesReady()) return false;
 
-	return true;
+	if (!UploadBitpackInput(g_pPhaseBuffer, phase, N * M * num_holograms * sizeof(float))) return false;
+
+	return DispatchBitpack(core, g_pComputeShader, BitpackConstants(N, M, num_holograms), hologram, format);
 }
 
-// Helper functions
+// Same for phases read through layout. A float view whose elements fit in the phase buffer is
+// copied over as one block, gaps included, and the shader follows its strides. Doubles, and views
+// spread too wide, are converted to dense floats as they're written to the buffer.
+template <typename T>
+static bool RunBitpackShader(
+	const PLMCore& core,
+	const T* phase,
+	const PhaseLayout& layout,
+	unsigned char* hologram,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms
+)
+{
+	if (num_holograms > 24) return false;
+
+	if (!phase || !hologram) {
+		std::cout << "Null pointer detected" << std::endl;
+		return false;
+	};
+
+	if (!BitpackResourcesReady()) return false;
+
+	int64_t first, last;
+	PhaseLayoutExtent(layout, N, M, num_holograms, first, last);
+	const uint64_t span = (uint64_t)(last - first + 1);
+	const bool in_place = std::is_same<T, float>::value && span <= N * M * HOLOGRAMS_PER_FRAME
+		&& std::llabs(layout.pixel_stride) <= INT32_MAX && std::llabs(layout.row_stride) <= INT32_MAX
+		&& std::llabs(layout.plane_stride) <= INT32_MAX;
+
+	c_Params constant = BitpackConstants(N, M, num_holograms);
+
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT hr = g_pd3dDeviceContext->Map(g_pPhaseBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	if (FAILED(hr)) return false;
+	if (in_place) {
+		memcpy(mappedResource.pData, phase + first, span * sizeof(float));
+		constant.pixel_stride = (int32_t)layout.pixel_stride;
+		constant.row_stride = (int32_t)layout.row_stride;
+		constant.plane_stride = (int32_t)layout.plane_stride;
+		constant.phase_offset = (int32_t)-first;
+	} else {
+		GatherPhases(phase, layout, (float*)mappedResource.pData, N, M, num_holograms);
+	};
+	g_pd3dDeviceContext->Unmap(g_pPhaseBuffer, 0);
+
+	return DispatchBitpack(core, g_pComputeShader, constant, hologram);
+}
+
+// Same for integer input: levels, which skip the lookup-table, or fixed-point phases
+static bool RunIntegerShader(
+	const PLMCore& core,
+	const void* input,
+	IntegerInput format,
+	unsigned char* hologram,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms
+)
+{
+	if (num_holograms > 24) return false;
+
+	if (!input || !hologram) {
+		std::cout << "Null pointer detected" << std::endl;
+		return false;
+	};
+
+	if (!BitpackResourcesReady() || !g_pIntegerShader || !g_pIntegerInputSRV || !g_pLevelTableSRV) return false;
+
+	const uint64_t elements = N * M * num_holograms;
+	size_t bytes = elements;
+	if (format == INTEGER_INPUT_LEVELS_NIBBLE) bytes = LevelBytes(LEVEL_FORMAT_NIBBLE, elements);
+	if (format == INTEGER_INPUT_PHASE_U16) bytes = elements * sizeof(uint16_t);
+	if (!UploadBitpackInput(g_pIntegerInputBuffer, input, bytes)) return false;
+
+	if (format == INTEGER_INPUT_PHASE_U8 || format == INTEGER_INPUT_PHASE_U16) {
+		// Only the entries of the input type are read
+		const PhaseQuantiser& quantiser = core.Quantiser();
+		const uint8_t* table = format == INTEGER_INPUT_PHASE_U8 ? quantiser.LevelsU8() : quantiser.LevelsU16();
+		D3D11_BOX box = { 0, 0, 0, (UINT)(format == INTEGER_INPUT_PHASE_U8 ? 256 : 65536), 1, 1 };
+		g_pd3dDeviceContext->UpdateSubresource(g_pLevelTableBuffer, 0, &box, table, 0, 0);
+	};
+
+	c_Params constant = BitpackConstants(N, M, num_holograms);
+	constant.input_format = (uint32_t)format;
+	return DispatchBitpack(core, g_pIntegerShader, constant, hologram);
+}
+
+// Quantises one N x M hologram with plane_main into nibble-packed levels. The shader stores
+// 8 levels per texel of the hologram texture, row after row, so only the first rows holding
+// N * M / 2 bytes are read back instead of a whole RGBA frame. Has to run on the render thread (RunOnRenderThread).
+static bool RunPlaneShader(
+	const PLMCore& core,
+	const float* phase,
+	std::vector<uint8_t>& levels,
+	unsigned long long N,
+	unsigned long long M
+)
+{
+	if (!phase) {
+		std::cout << "Null pointer detected" << std::endl;
+		return false;
+	};
+
+	if (!BitpackResourcesReady() || !g_pPlaneShader) return false;
+
+	if (!UploadBitpackInput(g_pPhaseBuffer, phase, N * M * sizeof(float))) return false;
+
+	BindBitpackShader(core, g_pPlaneShader, BitpackConstants(N, M, 1));
+
+	const uint64_t words = (N * M + 7) / 8;
+	const uint64_t row_words = 2 * N;
+	const uint64_t rows = (words + row_words - 1) / row_words;
+	g_pd3dDeviceContext->Dispatch((UINT)((words + 63) / 64), 1, 1);
+
+	D3D11_BOX box = { 0, 0, 0, (UINT)row_words, (UINT)rows, 1 };
+	g_pd3dDeviceContext->CopySubresourceRegion(pStagingTexture, 0, 0, 0, 0, pHologramTexture, 0, &box);
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT hr = g_pd3dDeviceContext->Map(pStagingTexture, 0, D3D11_MAP_READ, 0, &mapped);
+	if (FAILED(hr)) return false;
+
+	levels.resize(4 * words);
+	for (uint64_t row = 0; row < rows; row++) {
+		const uint64_t count = std::min(row_words, words - row * row_words);
+		memcpy(levels.data() + 4 * row * row_words, (uint8_t*)mapped.pData + row * mapped.RowPitch, 4 * count);
+	};
+
+	g_pd3dDeviceContext->Unmap(pStagingTexture, 0);
+
+	return true;
+}
+
+static bool BitpackHologramsGPU(
+	const PLMCore& core,
+	float* phase,
+	unsigned char* hologram,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms
+)
+{
+	// The phase buffer and hologram texture are sized for the window
+	if (!GPUFrameSizeMatches(N, M)) return false;
+
+	return RunOnRenderThread([&] { return RunBitpackShader(core, phase, hologram, N, M, num_holograms); });
+}
+
+template <typename T>
+static bool BitpackHologramsGPU(
+	const PLMCore& core,
+	const T* phase,
+	const PhaseLayout& layout,
+	unsigned char* hologram,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms
+)
+{
+	if (!GPUFrameSizeMatches(N, M)) return false;
+
+	return RunOnRenderThread([&] { return RunBitpackShader(core, phase, layout, hologram, N, M, num_holograms); });
+}
+
+static bool BitpackIntegerGPU(
+	const PLMCore& core,
+	const void* input,
+	IntegerInput format,
+	unsigned char* hologram,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms
+)
+{
+	if (!GPUFrameSizeMatches(N, M)) return false;
+
+	return RunOnRenderThread([&] { return RunIntegerShader(core, input, format, hologram, N, M, num_holograms); });
+}
+
+bool BitpackHologramsGPU(
+	float* phase,
+	unsigned char* hologram,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms
+) {
+	return PLM_BitpackHologramsGPU(&default_instance, phase, hologram, N, M, num_holograms);
+}
+
+bool BitpackAndInsert(
+	float* phase,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms,
+	unsigned long long offset
+) {
+	return PLM_BitpackAndInsert(&default_instance, phase, N, M, num_holograms, offset);
+}
+
+bool BitpackAndInsertGPU(
+	float* phase,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms,
+	unsigned long long offset	
+) {
+	return PLM_BitpackAndInsertGPU(&default_instance, phase, N, M, num_holograms, offset);
+}
+
+bool BitpackHologramsU8(unsigned char* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	return PLM_BitpackHologramsU8(&default_instance, phase, frame, N, M, num_holograms);
+}
+
+bool BitpackHologramsU16(unsigned short* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	return PLM_BitpackHologramsU16(&default_instance, phase, frame, N, M, num_holograms);
+}
+
+bool BitpackHologramsU8GPU(unsigned char* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	return PLM_BitpackHologramsU8GPU(&default_instance, phase, frame, N, M, num_holograms);
+}
+
+bool BitpackHologramsU16GPU(unsigned short* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	return PLM_BitpackHologramsU16GPU(&default_instance, phase, frame, N, M, num_holograms);
+}
+
+bool BitpackHologramsDouble(double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, int order, unsigned long long plane_stride) {
+	return PLM_BitpackHologramsDouble(&default_instance, phase, frame, N, M, num_holograms, order, plane_stride);
+}
+
+bool BitpackHologramsDoubleGPU(double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, int order, unsigned long long plane_stride) {
+	return PLM_BitpackHologramsDoubleGPU(&default_instance, phase, frame, N, M, num_holograms, order, plane_stride);
+}
+
+bool BitpackHologramsStrided(float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride) {
+	return PLM_BitpackHologramsStrided(&default_instance, phase, frame, N, M, num_holograms, pixel_stride, row_stride, plane_stride);
+}
+
+bool BitpackHologramsStridedGPU(float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride) {
+	return PLM_BitpackHologramsStridedGPU(&default_instance, phase, frame, N, M, num_holograms, pixel_stride, row_stride, plane_stride);
+}
+
+bool BitpackHologramsDoubleStrided(double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride) {
+	return PLM_BitpackHologramsDoubleStrided(&default_instance, phase, frame, N, M, num_holograms, pixel_stride, row_stride, plane_stride);
+}
+
+bool BitpackHologramsDoubleStridedGPU(double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride) {
+	return PLM_BitpackHologramsDoubleStridedGPU(&default_instance, phase, frame, N, M, num_holograms, pixel_stride, row_stride, plane_stride);
+}
+
+bool BitpackLevels(
+	unsigned char* levels,
+	int format,
+	unsigned char* frame,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms
+) {
+	return PLM_BitpackLevels(&default_instance, levels, format, frame, N, M, num_holograms);
+}
+
+bool BitpackLevelsGPU(
+	unsigned char* levels,
+	int format,
+	unsigned char* frame,
+	unsigned long long N,
+	unsigned long long M,
+	int num_holograms
+) {
+	return PLM_BitpackLevelsGPU(&default_instance, levels, format, frame, N, M, num_holograms);
+}
+
+bool BitpackAndInsertBatch(
+	float* phase,
+	unsigned long long N,
+	unsigned long long M,
+	unsigned long long num_holograms,
+	unsigned long long offset
+) {
+	return PLM_BitpackAndInsertBatch(&default_instance, phase, N, M, num_holograms, offset);
+}
+
+bool BitpackAndInsertBatchGPU(
+	float* phase,
+	unsigned long long N,
+	unsigned long long M,
+	unsigned long long num_holograms,
+	unsigned long long offset
+) {
+	return PLM_BitpackAndInsertBatchGPU(&default_instance, phase, N, M, num_holograms, offset);
+}
+
+bool UpdateHologramPlane(unsigned long long slot, int plane_index, float* phase) {
+	return PLM_UpdateHologramPlane(&default_instance, slot, plane_index, phase);
+}
+
+bool UpdateHologramPlaneGPU(unsigned long long slot, int plane_index, float* phase) {
+	return PLM_UpdateHologramPlaneGPU(&default_instance, slot, plane_index, phase);
+}
+
+// Instance API
+
+plm_handle PLM_Create(unsigned long long N, unsigned long long M, unsigned long long num_frames) {
+	plm_instance* instance = new plm_instance();
+	instance->core.ResetFrames(N, M, num_frames);
+	return instance;
+}
+
+bool PLM_Destroy(plm_handle handle) {
+	// The default instance lives as long as the DLL, and the one on display has to be stopped first
+	if (!handle || handle == &default_instance || (running && handle == ui_instance)) {
+		return false;
+	};
+	// The pool joins its threads when destroyed
+	delete handle;
+	return true;
+}
+
+plm_handle PLM_GetDefault() {
+	return &default_instance;
+}
+
+// On FreeLibrary the default instance is destroyed under the loader lock, where joining its
+// packing threads would deadlock. They're released first. At process exit (reserved set)
+// the threads are already gone and the destructor joins them as usual.
+BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved) {
+	if (reason == DLL_PROCESS_DETACH && reserved == nullptr) {
+		default_instance.core.ReleaseBitpackPool();
+	};
+	return TRUE;
+}
+
+void PLM_StartUI(plm_handle handle) {
+	if (!handle) return;
+	ui_start_requested = std::chrono::high_resolution_clock::now();
+
+	// The window shows 2N x 2M frames of the instance
+	if (running) {
+		StopUI();
+	};
+	N = (int)(handle->core.Frames().Width() / 2);
+	M = (int)(handle->core.Frames().Height() / 2);
+	LaunchUI(handle);
+}
+
+void PLM_SetLookupTable(plm_handle handle, float* lut) {
+	if (handle) handle->core.SetLookupTable(lut);
+}
+
+bool PLM_SetPhaseMap(plm_handle handle, int* phase_map) {
+	if (!handle) return false;
+	handle->core.SetPhaseMap(phase_map);
+	return true;
+}
+
+void PLM_SetBitpackThreads(plm_handle handle, unsigned int num_threads) {
+	if (handle) handle->core.SetBitpackThreads(num_threads);
+}
+
+void PLM_SetBitpackAffinity(plm_handle handle, bool pin) {
+	if (handle) handle->core.SetBitpackAffinity(pin);
+}
+
+bool PLM_BitpackHolograms(plm_handle handle, float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	if (!handle) return false;
+	return handle->core.BitpackHolograms(phase, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsGPU(plm_handle handle, float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	if (!handle) return false;
+	return BitpackHologramsGPU(handle->core, phase, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsU8(plm_handle handle, unsigned char* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	if (!handle) return false;
+	return handle->core.BitpackHolograms((const uint8_t*)phase, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsU16(plm_handle handle, unsigned short* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	if (!handle) return false;
+	return handle->core.BitpackHolograms((const uint16_t*)phase, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsU8GPU(plm_handle handle, unsigned char* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	if (!handle) return false;
+	return BitpackIntegerGPU(handle->core, phase, INTEGER_INPUT_PHASE_U8, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsU16GPU(plm_handle handle, unsigned short* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	if (!handle) return false;
+	return BitpackIntegerGPU(handle->core, phase, INTEGER_INPUT_PHASE_U16, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsDouble(plm_handle handle, double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, int order, unsigned long long plane_stride) {
+	if (!handle || (order != PHASE_ROW_MAJOR && order != PHASE_COLUMN_MAJOR)) return false;
+	return handle->core.BitpackHolograms(phase, MakePhaseLayout((PhaseOrder)order, N, M, plane_stride), frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsDoubleGPU(plm_handle handle, double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, int order, unsigned long long plane_stride) {
+	if (!handle || (order != PHASE_ROW_MAJOR && order != PHASE_COLUMN_MAJOR)) return false;
+	return BitpackHologramsGPU(handle->core, phase, MakePhaseLayout((PhaseOrder)order, N, M, plane_stride), frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsStrided(plm_handle handle, float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride) {
+	if (!handle) return false;
+	const PhaseLayout layout = { pixel_stride, row_stride, plane_stride };
+	return handle->core.BitpackHolograms(phase, layout, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsStridedGPU(plm_handle handle, float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride) {
+	if (!handle) return false;
+	const PhaseLayout layout = { pixel_stride, row_stride, plane_stride };
+	return BitpackHologramsGPU(handle->core, phase, layout, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsDoubleStrided(plm_handle handle, double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride) {
+	if (!handle) return false;
+	const PhaseLayout layout = { pixel_stride, row_stride, plane_stride };
+	return handle->core.BitpackHolograms(phase, layout, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackHologramsDoubleStridedGPU(plm_handle handle, double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride) {
+	if (!handle) return false;
+	const PhaseLayout layout = { pixel_stride, row_stride, plane_stride };
+	return BitpackHologramsGPU(handle->core, phase, layout, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackLevels(plm_handle handle, unsigned char* levels, int format, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	if (!handle || (format != LEVEL_FORMAT_U8 && format != LEVEL_FORMAT_NIBBLE)) return false;
+	return handle->core.BitpackLevels(levels, (LevelFormat)format, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackLevelsGPU(plm_handle handle, unsigned char* levels, int format, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms) {
+	if (!handle || (format != LEVEL_FORMAT_U8 && format != LEVEL_FORMAT_NIBBLE)) return false;
+	return BitpackIntegerGPU(handle->core, levels, (IntegerInput)format, frame, N, M, num_holograms);
+}
+
+bool PLM_BitpackAndInsert(plm_handle handle, float* phase, unsigned long long N, unsigned long long M, int num_holograms, unsigned long long offset) {
+	if (!handle || !phase) return false;
+
+	// Packed straight into the slot on this thread, the presenter uploads it again once it's written
+	bool success = handle->core.BitpackAndInsert(phase, N, M, num_holograms, offset);
+
+	if (!success) {
+		std::cerr << "Failed to bitpack holograms" << std::endl;
+		return false;
+	};
+
+	PLM_SetFrame(handle, offset);
+
+	return true;
+}
+
+bool PLM_BitpackAndInsertGPU(plm_handle handle, float* phase, unsigned long long N, unsigned long long M, int num_holograms, unsigned long long offset) {
+	if (!handle) return false;
+
+	FrameStore& frame_set = handle->core.Frames();
+	if (offset >= frame_set.NumFrames() || num_holograms < 1 || num_holograms > HOLOGRAMS_PER_FRAME
+		|| !GPUFrameSizeMatches(N, M) || frame_set.Width() != 2 * N || frame_set.Height() != 2 * M) {
+		std::cerr << "Failed to bitpack holograms" << std::endl;
+		return false;
+	};
+
+	// The readback goes straight into the slot as RGB. The slot is claimed on the render thread,
+	// under the frame lock, so a resize queued before this can't move it.
+	bool success = RunOnRenderThread([&] {
+		auto frames_lock = frame_set.LockFrames();
+		uint8_t* slot = frame_set.FramesToOverwrite(offset);
+		if (slot == nullptr || !RunBitpackShader(handle->core, phase, slot, N, M, num_holograms, FRAME_FORMAT_RGB)) return false;
+		frame_set.Touch(offset);
+		return true;
+	});
+
+	if (!success) {
+		std::cerr << "Failed to bitpack holograms" << std::endl;
+		return false;
+	};
+
+	PLM_SetFrame(handle, offset);
+
+	return true;
+}
+
+bool PLM_BitpackAndInsertBatch(plm_handle handle, float* phase, unsigned long long N, unsigned long long M, unsigned long long num_holograms, unsigned long long offset) {
+	if (!handle || !phase) return false;
+
+	// Frames are packed straight into the store on the CPU threads, the presenter keeps going
+	bool success = handle->core.BitpackAndInsertBatch(phase, N, M, num_holograms, offset);
+
+	if (!success) {
+		std::cerr << "Failed to bitpack batch" << std::endl;
+	};
+	return success;
+}
+
+bool PLM_BitpackAndInsertBatchGPU(plm_handle handle, float* phase, unsigned long long N, unsigned long long M, unsigned long long num_holograms, unsigned long long offset) {
+	if (!handle || !phase) return false;
+
+	FrameStore& frame_set = handle->core.Frames();
+	const uint64_t num_frames = (num_holograms + HOLOGRAMS_PER_FRAME - 1) / HOLOGRAMS_PER_FRAME;
+	if (num_frames == 0 || offset + num_frames > frame_set.NumFrames() || offset + num_frames < offset) {
+		return false;
+	};
+	if (!GPUFrameSizeMatches(N, M) || frame_set.Width() != 2 * N || frame_set.Height() != 2 * M) {
+		return false;
+	};
+
+	// Frames go through the shader one command at a time, so the render loop presents in between,
+	// and are read back straight into their slots
+	bool success = true;
+	for (uint64_t f = 0; f < num_frames && success; f++) {
+		int holograms = (int)std::min<uint64_t>(HOLOGRAMS_PER_FRAME, num_holograms - f * HOLOGRAMS_PER_FRAME);
+		success = RunOnRenderThread([&] {
+			auto frames_lock = frame_set.LockFrames();
+			uint8_t* slot = frame_set.FramesToOverwrite(offset + f);
+			if (slot == nullptr || !RunBitpackShader(handle->core, phase + f * HOLOGRAMS_PER_FRAME * N * M, slot, N, M, holograms, FRAME_FORMAT_RGB)) return false;
+			frame_set.Touch(offset + f);
+			return true;
+		});
+	};
+
+	if (!success) {
+		std::cerr << "Failed to bitpack batch" << std::endl;
+	};
+	return success;
+}
+
+bool PLM_UpdateHologramPlane(plm_handle handle, unsigned long long slot, int plane_index, float* phase) {
+	if (!handle || !phase) return false;
+	// Like InsertFrames, the slot is re-uploaded next time it's shown
+	return handle->core.UpdateHologramPlane(slot, plane_index, phase);
+}
+
+bool PLM_UpdateHologramPlaneGPU(plm_handle handle, unsigned long long slot, int plane_index, float* phase) {
+	if (!handle || !phase) return false;
+
+	FrameStore& frame_set = handle->core.Frames();
+	if (slot >= frame_set.NumFrames() || plane_index < 0 || plane_index >= HOLOGRAMS_PER_FRAME) {
+		return false;
+	};
+	const uint64_t N = frame_set.Width() / 2;
+	const uint64_t M = frame_set.Height() / 2;
+	if (!GPUFrameSizeMatches(N, M)) return false;
+
+	// The GPU only quantises, the 4 bits of every pixel are merged into the slot on the CPU
+	bool success = RunOnRenderThread([&] { return RunPlaneShader(handle->core, phase, handle->gpu_frame, N, M); });
+
+	if (success) {
+		success = handle->core.UpdateHologramPlane(slot, plane_index, handle->gpu_frame.data(), LEVEL_FORMAT_NIBBLE);
+	};
+	if (!success) {
+		std::cerr << "Failed to update hologram plane" << std::endl;
+	};
+	return success;
+}
+
+bool PLM_InsertFrames(plm_handle handle, unsigned char* frame, unsigned long long num_frames, unsigned long long offset, int type) {
+	if (!handle || (type != FRAME_FORMAT_RGB && type != FRAME_FORMAT_RGBA)) {
+		return false;
+	};
+	// Fails if it exceeds the maximum number of frames we can store
+	return handle->core.InsertFrames(frame, num_frames, offset, (FrameFormat)type);
+}
+
+bool PLM_GrabFrame(plm_handle handle, unsigned char* frame, unsigned long long index) {
+	if (!handle) return false;
+	return handle->core.Frames().Read(index, frame);
+}
+
+unsigned char* PLM_AcquireFrameSlot(plm_handle handle, unsigned long long slot, unsigned long long* pitch) {
+	if (!handle) return nullptr;
+
+	FrameStore& frame_set = handle->core.Frames();
+	uint8_t* frame = frame_set.Acquire(slot);
+	if (frame != nullptr && pitch != nullptr) *pitch = frame_set.Pitch();
+	return frame;
+}
+
+bool PLM_CommitFrameSlot(plm_handle handle, unsigned long long slot) {
+	if (!handle) return false;
+	// The presenter picks the slot up next time it's shown
+	return handle->core.Frames().Commit(slot);
+}
+
+bool PLM_ResizeFrameStore(plm_handle handle, unsigned long long num_frames) {
+	if (!handle) return false;
+
+	// Runs between two presents, so the render loop never sees the store move. The window
+	// and GPU resources stay up. Fails while another thread is writing frames (FrameStore::LockFrames).
+	bool success = RunOnRenderThread([&] {
+		if (!handle->core.ResizeFrames(num_frames)) return false;
+		if (handle == ui_instance) MAX_FRAMES = num_frames;
+		return true;
+	}, false);
+
+	if (!success) {
+		std::cerr << "Failed to resize the frame store, a slot is leased or frames are being written" << std::endl;
+	};
+	return success;
+}
+
+bool PLM_SetFrameSequence(plm_handle handle, unsigned long long* sequence, unsigned long long length) {
+	if (!handle) return false;
+	return handle->core.Sequence().SetOrder((const uint64_t*)sequence, length);
+}
+
+bool PLM_SetFrameSequenceDwell(plm_handle handle, unsigned long long* sequence, unsigned int* dwell, unsigned long long length) {
+	if (!handle) return false;
+	// Held frames are uploaded once and presented again, the buffer index counts every vsync
+	return handle->core.Sequence().SetOrder((const uint64_t*)sequence, length, (const uint32_t*)dwell);
+}
+
+bool PLM_SetFrame(plm_handle handle, unsigned long long offset) {
+	if (!handle) return false;
+	return handle->core.Sequence().SetFrame(offset);
+}
+
+bool PLM_StartSequence(plm_handle handle, int number_of_frames) {
+	if (!handle) return false;
+	return handle->core.Sequence().Start(number_of_frames);
+}
+
+bool PLM_GetSequenceStatus(plm_handle handle, long long* status) {
+	if (!handle || !status) return false;
+	// Published by the render loop every vsync, reading it never holds the loop up
+	const SequencerStatus sequence = handle->core.Sequence().Status();
+	status[0] = sequence.mode;
+	status[1] = sequence.active;
+	status[2] = sequence.frames_to_play;
+	status[3] = sequence.frames_in_sequence;
+	status[4] = sequence.frame_index;
+	status[5] = sequence.buffer_index;
+	status[6] = (long long)sequence.slot;
+	status[7] = (long long)sequence.vsync;
+	return true;
+}
+
+bool PLM_PresentHeadless(plm_handle handle, unsigned long long num_vsyncs, double refresh_rate) {
+	// The instance on display is stepped by the window, not here
+	if (!handle || (running && handle == ui_instance)) {
+		return false;
+	};
+	handle->presenter.SetRefreshRate(refresh_rate);
+	handle->presenter.SetPaced(true);
+	handle->presenter.SetSequenceEndDelay(delay);
+	handle->presenter.Run(num_vsyncs);
+	handle->presenter.ClearLog();
+	return true;
+}
+
+// Helper functions
 bool CreateDeviceD3D(HWND hWnd)
 {
 	// Setup swap chain
@@ -1147,11 +1969,19 @@ bool CreateDeviceD3D(HWND hWnd)
 	std::cout << "Feature Level: " << std::hex << featureLevel << std::dec << std::endl;
 	CreateRenderTarget();
 
-    if (!CompileComputeShader(g_pd3dDevice)){
+    if (!CompileComputeShader(g_pd3dDevice, "main", &g_pComputeShader)){
         std::cerr << "Failed to compile bitpack compute shader" << std::endl;
         //return false;
     }
 
+    if (!CompileComputeShader(g_pd3dDevice, "integer_main", &g_pIntegerShader)){
+        std::cerr << "Failed to compile integer input bitpack compute shader" << std::endl;
+    }
+
+    if (!CompileComputeShader(g_pd3dDevice, "plane_main", &g_pPlaneShader)){
+        std::cerr << "Failed to compile hologram plane compute shader" << std::endl;
+    }
+
     if (!InitBitpackResources()){
         std::cerr << "Failed to initialize bitpack resources" << std::endl;
         //return false;
@@ -1167,6 +1997,12 @@ void CleanupDeviceD3D()
 	if (g_pd3dDevice) { g_pd3dDevice->Release(); g_pd3dDevice = nullptr; }
 	//// Compute shader cleanup
 	if (g_pComputeShader) { g_pComputeShader->Release(); g_pComputeShader = nullptr; }
+	if (g_pIntegerShader) { g_pIntegerShader->Release(); g_pIntegerShader = nullptr; }
+	if (g_pPlaneShader) { g_pPlaneShader->Release(); g_pPlaneShader = nullptr; }
+	if (g_pIntegerInputSRV) { g_pIntegerInputSRV->Release(); g_pIntegerInputSRV = nullptr; }
+	if (g_pIntegerInputBuffer) { g_pIntegerInputBuffer->Release(); g_pIntegerInputBuffer = nullptr; }
+	if (g_pLevelTableSRV) { g_pLevelTableSRV->Release(); g_pLevelTableSRV = nullptr; }
+	if (g_pLevelTableBuffer) { g_pLevelTableBuffer->Release(); g_pLevelTableBuffer = nullptr; }
 	if (pStagingTexture) { pStagingTexture->Release(); pStagingTexture = nullptr; }
 	if (g_pHologramUAV) { g_pHologramUAV->Release(); g_pHologramUAV = nullptr; }
 	if (pHologramTexture) { pHologramTexture->Release(); pHologramTexture = nullptr; }
@@ -1228,12 +2064,15 @@ LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	return ::DefWindowProcW(hWnd, msg, wParam, lParam);
 }
 
-bool bitpackDebugInit = false;
 void DebugWindow(
 	bool show,
 	ImGuiIO& io
 ) {
 
+	PLMCore& plm_core = ui_instance->core;
+	FrameStore& frame_set = plm_core.Frames();
+	Sequencer& sequencer = plm_core.Sequence();
+
 	static long long unsigned int ui_cycles = 0;
 	bool plm_updating_status = false;
 	
@@ -1297,18 +2136,21 @@ void DebugWindow(
 
 		//Status(first_frame_trigger);
 		ImGui::SeparatorText("Sequence");
-		ImGui::Text("Frames to play: %d/%d", frames_to_play, frames_in_sequence);
-		ImGui::Text("Buffer Index %d/%d", 24 * buffer_index, 24 * frames_in_sequence);
+		ImGui::Text("Frames to play: %d/%d", sequencer.FramesToPlay(), sequencer.FramesInSequence());
+		ImGui::Text("Buffer Index %d/%d", 24 * sequencer.BufferIndex(), 24 * sequencer.FramesInSequence());
 
 		ImGui::Text("Frame order:");
 		ImGui::SameLine();
 		ImGui::Text("[");
 		ImGui::SameLine();
-		for (int i = 0; i < (MAX_FRAMES <= 4 ? (MAX_FRAMES - 1) : 4); ++i) {
+		// The order can be much longer than the frame store
+		const std::vector<uint64_t>& frame_order = sequencer.Order();
+		const int order_length = (int)frame_order.size();
+		for (int i = 0; i < (order_length <= 4 ? (order_length - 1) : 4); ++i) {
 			ImGui::Text("%llu", frame_order[i]);
 			ImGui::SameLine();
 		};
-		ImGui::Text("... %llu], total: %d", frame_order[MAX_FRAMES - 1], MAX_FRAMES);
+		ImGui::Text("... %llu], total: %d", frame_order[order_length - 1], order_length);
 
 		ImGui::SeparatorText("Frame Data");
 		if (ImGui::TreeNode("Frame on display")) {
@@ -1319,22 +2161,21 @@ void DebugWindow(
 			ImGui::TreePop();
 		};
 		ImGui::Text("Frame pointer [%p]", plm_image_ptr);
-		ImGui::Text("Frame index: [%d], Frame [%d]", frame_index, frame_order[frame_index % MAX_FRAMES]);
+		ImGui::Text("Frame index: [%d], Frame [%d]", sequencer.FrameIndex(), sequencer.Slot());
 		ImGui::SameLine();
-		if (ImGui::ArrowButton("##left", ImGuiDir_Left)) { frame_index--; frame_index = clamp(frame_index, 0, MAX_FRAMES - 1); }
+		if (ImGui::ArrowButton("##left", ImGuiDir_Left)) { sequencer.SetFrameIndex(sequencer.FrameIndex() - 1); }
 		ImGui::SameLine();
-		if (ImGui::ArrowButton("##right", ImGuiDir_Right)) { frame_index++; frame_index = clamp(frame_index, 0, MAX_FRAMES - 1); }
+		if (ImGui::ArrowButton("##right", ImGuiDir_Right)) { sequencer.SetFrameIndex(sequencer.FrameIndex() + 1); }
 
 		static int frame_index_i32 = 0;
-		frame_index_i32 = frame_index;
-		if (ImGui::SliderInt("Frame index", &frame_index_i32, 0, MAX_FRAMES - 1)) {
-			frame_index = clamp(frame_index_i32, 0, MAX_FRAMES - 1);
+		frame_index_i32 = (int)sequencer.FrameIndex();
+		if (ImGui::SliderInt("Frame index", &frame_index_i32, 0, order_length - 1)) {
+			sequencer.SetFrameIndex(frame_index_i32);
 		};
 
-		static std::vector<float> phase(N * M * 24);
-		static std::vector<unsigned char> hologram(4 * 2 * N * 2 * M);
-
-		if (bitpackDebugInit == false) {
+		// The test pattern is only built when asked for, it takes N * M * 24 floats
+		if (ImGui::Button("Pack test pattern into this frame")) {
+			std::vector<float> phase(N * M * 24);
 			for (auto n = 0; n < 24; n++) {
 				for (auto j = 0; j < M; j++) {
 					for (auto i = 0; i < N; i++) {
@@ -1342,8 +2183,8 @@ void DebugWindow(
 					}
 				};
 			};
-			bitpackDebugInit = true;
-		};	
+			plm_core.BitpackAndInsert(phase.data(), N, M, 24, sequencer.Slot());
+		};
 
 		ImGui::SeparatorText("GPU Resources Initialization");
 		ImGui::Text("Compute Shader"); ImGui::SameLine(); BitGreen(g_pComputeShader != nullptr, false);
@@ -1356,13 +2197,13 @@ void DebugWindow(
 		ImGui::Text("Staging Texture:"); ImGui::SameLine(); BitGreen(pStagingTexture != nullptr, false);
 
 		ImGui::SeparatorText("LUT");
-		ImGui::PlotLines("LUT", phases, 17);
+		ImGui::PlotLines("LUT", plm_core.LookupTable(), QUANTISER_LUT_SIZE);
 		// Display phase_map
 		if (ImGui::TreeNode("Phase map [0...15]: ")) {
 
 			for (int j = 0; j < 4; j++) {
 				for (int i = 0; i < 16; i++) {
-					Bit(phase_map[i * 4 + j], i < 15);
+					Bit(plm_core.PhaseMap()[i * 4 + j], i < 15);
 				};
 			};
 			ImGui::TreePop();
@@ -1372,6 +2213,11 @@ void DebugWindow(
 		ImGui::Text("UI Content: %f ms", elapsed_content.count() * 1000);
 		ImGui::Text("Buffer Swap: %f ms", elapsed_buffer.count() * 1000);
 		ImGui::Text("Total: %f ms", elapsed_total.count() * 1000);
+		ImGui::Text("CPU bitpacking: %s, %u threads%s", BitpackISAName(DetectBitpackISA()), plm_core.BitpackPool().Size(), plm_core.BitpackPool().HasAffinity() ? " (pinned)" : "");
+		ImGui::Text("Frame store: %llu frames, %.1f MB", frame_set.NumFrames(), frame_set.TotalBytes() / (1024.0 * 1024.0));
+		ImGui::Text("StartUI to first present: %f ms", startup_latency.count() * 1000);
+		ImGui::Text("ResumeUI to present: %f ms (worst %f ms)", resume_latency_last, resume_latency_worst);
+		ImGui::Text("Texture uploads: %llu, skipped: %llu", texture_uploads, texture_uploads_skipped);
 
 		ImGui::EndTabItem();
 		}
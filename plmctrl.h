@@ -15,6 +15,10 @@ extern "C" {
 	PLM_API void StopUI();
 	PLM_API bool PauseUI();
 	PLM_API bool ResumeUI();
+	// Render loop state: 0 idle (no UI), 1 playing, 2 paused, 3 draining (waiting out the end of a sequence)
+	PLM_API int GetUIState();
+	// Time from the last ResumeUI to the next present, in ms
+	PLM_API double GetResumeLatency();
 	PLM_API bool StartSequence(int number_of_frames);
 	PLM_API bool SetPhaseMap(int* new_phase_map);
 	PLM_API void SetPLMWindowPos(int width, int height, int x0, int y0);
@@ -31,6 +35,15 @@ extern "C" {
 		unsigned long long N,
 		unsigned long long M,
 		int num_holograms);
+	// Packs up to 24 holograms straight into frame slot offset and shows it. Each frame is
+	// written to memory once, as RGB, with no RGBA frame in between.
+	PLM_API bool BitpackAndInsert(
+		float* phase,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms,
+		unsigned long long offset
+	);
 	PLM_API bool BitpackAndInsertGPU(
 		float* phase,
 		unsigned long long N,
@@ -38,12 +51,176 @@ extern "C" {
 		int num_holograms,
 		unsigned long long offset
 	);
+	// Fixed-point phases: uint8 v stands for v / 255, uint16 v for v / 65535
+	PLM_API bool BitpackHologramsU8(unsigned char* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms);
+	PLM_API bool BitpackHologramsU16(unsigned short* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms);
+	PLM_API bool BitpackHologramsU8GPU(unsigned char* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms);
+	PLM_API bool BitpackHologramsU16GPU(unsigned short* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms);
+	// Double-precision phases read in place. order 0 is row-major (N x M x num_holograms as above),
+	// 1 column-major (an M x N x num_holograms MATLAB array). Holograms are plane_stride elements apart, N * M if 0
+	PLM_API bool BitpackHologramsDouble(double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, int order, unsigned long long plane_stride);
+	PLM_API bool BitpackHologramsDoubleGPU(double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, int order, unsigned long long plane_stride);
+	// Phases read through any element strides, negative ones included:
+	// element (i, j, n) is phase[i * pixel_stride + j * row_stride + n * plane_stride]
+	PLM_API bool BitpackHologramsStrided(float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride);
+	PLM_API bool BitpackHologramsStridedGPU(float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride);
+	PLM_API bool BitpackHologramsDoubleStrided(double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride);
+	PLM_API bool BitpackHologramsDoubleStridedGPU(double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride);
+	// Packs up to 24 holograms given as levels 0-15, one per byte (format = 0) or two per byte (format = 1)
+	PLM_API bool BitpackLevels(
+		unsigned char* levels,
+		int format,
+		unsigned char* frame,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms);
+	PLM_API bool BitpackLevelsGPU(
+		unsigned char* levels,
+		int format,
+		unsigned char* frame,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms);
+	// Packs any number of holograms, 24 per frame, into consecutive frames from offset
+	PLM_API bool BitpackAndInsertBatch(
+		float* phase,
+		unsigned long long N,
+		unsigned long long M,
+		unsigned long long num_holograms,
+		unsigned long long offset
+	);
+	PLM_API bool BitpackAndInsertBatchGPU(
+		float* phase,
+		unsigned long long N,
+		unsigned long long M,
+		unsigned long long num_holograms,
+		unsigned long long offset
+	);
+	// Replaces hologram plane_index (0-23) of a stored frame with the N x M phases in phase,
+	// the other 23 holograms of the slot stay as they are
+	PLM_API bool UpdateHologramPlane(unsigned long long slot, int plane_index, float* phase);
+	PLM_API bool UpdateHologramPlaneGPU(unsigned long long slot, int plane_index, float* phase);
+	PLM_API void SetBitpackThreads(unsigned int num_threads);
+	PLM_API void SetBitpackAffinity(bool pin);
 	PLM_API void SetLookupTable(float* lut);
+	// Frame-store slot for each step of a sequence. Any length, a scan can revisit the same frames.
 	PLM_API bool SetFrameSequence(unsigned long long*, unsigned long long length);
+	// Same, with each step held on the PLM for dwell[i] vsyncs (at least 1)
+	PLM_API bool SetFrameSequenceDwell(unsigned long long* sequence, unsigned int* dwell, unsigned long long length);
 	PLM_API bool SetPLMFrame(unsigned long long offset);
+	// Fills status[8] with the sequencer state as of the last vsync: mode (0 idle, 1 playing),
+	// sequence armed, frames to play, frames in sequence, frame index, buffer index, slot, vsync count
+	PLM_API bool GetSequenceStatus(long long* status);
 	PLM_API bool InsertPLMFrame(unsigned char* frame, unsigned long long num_frames, unsigned long long offset, int type);
+	// Leases frame slot for writing in place: returns its packed RGB data (pitch bytes per row,
+	// 2M rows), or NULL if the slot doesn't exist or is already leased. The slot isn't uploaded
+	// until CommitFrameSlot publishes the new contents: if the sequence reaches it meanwhile, the
+	// display keeps the frame shown before it, while GetSequenceStatus reports the leased slot.
+	PLM_API unsigned char* AcquireFrameSlot(unsigned long long slot, unsigned long long* pitch);
+	PLM_API bool CommitFrameSlot(unsigned long long slot);
+	// Changes the number of frames the frame store holds while the window keeps running.
+	// Stored frames and the frame order are kept where they fit. Fails during a sequence.
+	PLM_API bool ResizeFrameStore(unsigned long long num_frames);
 	PLM_API void ResetUI();
 
+	// Instance API. Every handle owns its own lookup-table, phase map, CPU packing threads,
+	// frame store, sequencer and headless presenter, so independent pipelines can run side
+	// by side. The functions above work on the default instance. There is a single PLM
+	// window: PLM_StartUI moves it to the given instance, and the GPU functions only take
+	// frames of the window's size.
+	typedef struct plm_instance* plm_handle;
+
+	PLM_API plm_handle PLM_Create(unsigned long long N, unsigned long long M, unsigned long long num_frames);
+	PLM_API bool PLM_Destroy(plm_handle handle);
+	PLM_API plm_handle PLM_GetDefault();
+	PLM_API void PLM_StartUI(plm_handle handle);
+	PLM_API void PLM_SetLookupTable(plm_handle handle, float* lut);
+	PLM_API bool PLM_SetPhaseMap(plm_handle handle, int* phase_map);
+	PLM_API void PLM_SetBitpackThreads(plm_handle handle, unsigned int num_threads);
+	PLM_API void PLM_SetBitpackAffinity(plm_handle handle, bool pin);
+	PLM_API bool PLM_BitpackHolograms(
+		plm_handle handle,
+		float* phase,
+		unsigned char* frame,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms);
+	PLM_API bool PLM_BitpackHologramsGPU(
+		plm_handle handle,
+		float* phase,
+		unsigned char* frame,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms);
+	PLM_API bool PLM_BitpackHologramsU8(plm_handle handle, unsigned char* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms);
+	PLM_API bool PLM_BitpackHologramsU16(plm_handle handle, unsigned short* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms);
+	PLM_API bool PLM_BitpackHologramsU8GPU(plm_handle handle, unsigned char* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms);
+	PLM_API bool PLM_BitpackHologramsU16GPU(plm_handle handle, unsigned short* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms);
+	PLM_API bool PLM_BitpackHologramsDouble(plm_handle handle, double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, int order, unsigned long long plane_stride);
+	PLM_API bool PLM_BitpackHologramsDoubleGPU(plm_handle handle, double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, int order, unsigned long long plane_stride);
+	PLM_API bool PLM_BitpackHologramsStrided(plm_handle handle, float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride);
+	PLM_API bool PLM_BitpackHologramsStridedGPU(plm_handle handle, float* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride);
+	PLM_API bool PLM_BitpackHologramsDoubleStrided(plm_handle handle, double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride);
+	PLM_API bool PLM_BitpackHologramsDoubleStridedGPU(plm_handle handle, double* phase, unsigned char* frame, unsigned long long N, unsigned long long M, int num_holograms, long long pixel_stride, long long row_stride, long long plane_stride);
+	PLM_API bool PLM_BitpackLevels(
+		plm_handle handle,
+		unsigned char* levels,
+		int format,
+		unsigned char* frame,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms);
+	PLM_API bool PLM_BitpackLevelsGPU(
+		plm_handle handle,
+		unsigned char* levels,
+		int format,
+		unsigned char* frame,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms);
+	PLM_API bool PLM_BitpackAndInsert(
+		plm_handle handle,
+		float* phase,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms,
+		unsigned long long offset);
+	PLM_API bool PLM_BitpackAndInsertGPU(
+		plm_handle handle,
+		float* phase,
+		unsigned long long N,
+		unsigned long long M,
+		int num_holograms,
+		unsigned long long offset);
+	PLM_API bool PLM_BitpackAndInsertBatch(
+		plm_handle handle,
+		float* phase,
+		unsigned long long N,
+		unsigned long long M,
+		unsigned long long num_holograms,
+		unsigned long long offset);
+	PLM_API bool PLM_BitpackAndInsertBatchGPU(
+		plm_handle handle,
+		float* phase,
+		unsigned long long N,
+		unsigned long long M,
+		unsigned long long num_holograms,
+		unsigned long long offset);
+	PLM_API bool PLM_UpdateHologramPlane(plm_handle handle, unsigned long long slot, int plane_index, float* phase);
+	PLM_API bool PLM_UpdateHologramPlaneGPU(plm_handle handle, unsigned long long slot, int plane_index, float* phase);
+	PLM_API bool PLM_InsertFrames(plm_handle handle, unsigned char* frame, unsigned long long num_frames, unsigned long long offset, int type);
+	PLM_API bool PLM_GrabFrame(plm_handle handle, unsigned char* frame, unsigned long long index);
+	PLM_API unsigned char* PLM_AcquireFrameSlot(plm_handle handle, unsigned long long slot, unsigned long long* pitch);
+	PLM_API bool PLM_CommitFrameSlot(plm_handle handle, unsigned long long slot);
+	PLM_API bool PLM_ResizeFrameStore(plm_handle handle, unsigned long long num_frames);
+	PLM_API bool PLM_SetFrameSequence(plm_handle handle, unsigned long long* sequence, unsigned long long length);
+	PLM_API bool PLM_SetFrameSequenceDwell(plm_handle handle, unsigned long long* sequence, unsigned int* dwell, unsigned long long length);
+	PLM_API bool PLM_SetFrame(plm_handle handle, unsigned long long offset);
+	PLM_API bool PLM_StartSequence(plm_handle handle, int number_of_frames);
+	PLM_API bool PLM_GetSequenceStatus(plm_handle handle, long long* status);
+	// Runs num_vsyncs vsyncs of the instance's sequence on a simulated display, on the calling thread
+	PLM_API bool PLM_PresentHeadless(plm_handle handle, unsigned long long num_vsyncs, double refresh_rate);
+
 	// Direct PLM comms
 
 	PLM_API int SetSource(unsigned int source, unsigned int portWidth);
@@ -1,13 +1,22 @@
+// Layout has to match c_Params in plmctrl.cpp, which checks it when the shaders are compiled
 cbuffer Constants : register(b0)
 {
     uint N;
     uint M;
     uint num_holograms;
+    uint input_format; // integer_main only: 0 u8 levels, 1 nibble-packed levels, 2 u8 phase, 3 u16 phase
+    // main only: phase element (i, j, n) is phase[phase_offset + i * pixel_stride + j * row_stride + n * plane_stride]
+    int pixel_stride;
+    int row_stride;
+    int plane_stride;
+    int phase_offset;
 };
 
 StructuredBuffer<float> phase : register(t0);
 StructuredBuffer<float> phases : register(t1);
 StructuredBuffer<int> phase_map : register(t2);
+ByteAddressBuffer integer_input : register(t3);
+ByteAddressBuffer level_table : register(t4); // Level of every u8 or u16 phase value, one byte each
 
 RWTexture2D<uint> hologram : register(u0);
 
@@ -26,10 +35,28 @@ uint QuantisePhase(float phaseVal)
     return 0; // Default if outside range
 }
 
-[numthreads(16, 16, 1)]
-void main(uint3 DTid : SV_DispatchThreadID)
+uint LoadByte(ByteAddressBuffer buffer, uint byte_index)
+{
+    return (buffer.Load(byte_index & ~3u) >> (8 * (byte_index & 3))) & 0xFF;
+}
+
+// Level of element e of the integer input. Nibble-packed levels hold element e in the
+// low nibble of byte e / 2 for even e, the high one for odd e.
+uint LoadLevel(uint e)
+{
+    if (input_format == 0)
+        return LoadByte(integer_input, e) & 15;
+    if (input_format == 1)
+        return (LoadByte(integer_input, e / 2) >> (4 * (e & 1))) & 15;
+    if (input_format == 2)
+        return LoadByte(level_table, LoadByte(integer_input, e));
+
+    uint v = (integer_input.Load((2 * e) & ~3u) >> (16 * (e & 1))) & 0xFFFF;
+    return LoadByte(level_table, v);
+}
+
+void PackTexel(uint2 pos, bool from_integer)
 {
-    uint2 pos = DTid.xy;
     if (pos.x >= 2 * N || pos.y >= 2 * M)
         return;
 
@@ -60,8 +87,11 @@ void main(uint3 DTid : SV_DispatchThreadID)
     {
         uint color_id = n / 8; // 0 for R (n=0-7), 1 for G (n=8-15), 2 for B (n=16-23)
         uint offset = n % 8; // Bit position within the byte (0-7)
-        float phase_val = phase[i + j * N + n * N * M];
-        uint level = QuantisePhase(phase_val);
+        uint level;
+        if (from_integer)
+            level = LoadLevel(i + j * N + n * N * M);
+        else
+            level = QuantisePhase(phase[phase_offset + (int)i * pixel_stride + (int)j * row_stride + (int)n * plane_stride]);
         uint bit = phase_map[level * 4 + k];
       
         color[color_id] |= (bit << offset);
@@ -70,3 +100,43 @@ void main(uint3 DTid : SV_DispatchThreadID)
     hologram[pos] = color.r | color.g << 8 | color.b << 16 | color.a << 24;
 
 }
+
+[numthreads(16, 16, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    PackTexel(DTid.xy, false);
+}
+
+// Same packing for integer input: levels 0-15, which don't use the lookup-table, or
+// fixed-point phases mapped to levels through level_table
+[numthreads(16, 16, 1)]
+void integer_main(uint3 DTid : SV_DispatchThreadID)
+{
+    PackTexel(DTid.xy, true);
+}
+
+// Levels of a single hologram, for replacing one plane of a stored frame. Each thread
+// quantises 8 pixels into a nibble-packed word (element e in bits 4 * (e % 8) of word e / 8),
+// and the words fill the hologram texture row by row.
+[numthreads(64, 1, 1)]
+void plane_main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint w = DTid.x;
+    uint elements = N * M;
+    if (8 * w >= elements)
+        return;
+
+    uint word = 0;
+    for (uint b = 0; b < 8; b++)
+    {
+        uint e = 8 * w + b;
+        if (e < elements)
+        {
+            uint i = e % N;
+            uint j = e / N;
+            word |= QuantisePhase(phase[phase_offset + (int)i * pixel_stride + (int)j * row_stride]) << (4 * b);
+        }
+    }
+
+    hologram[uint2(w % (2 * N), w / (2 * N))] = word;
+}
@@ -39,13 +39,21 @@ plm.Stop = @Stop;                    % PLM stops reading from the screen
 plm.StopUI = @StopUI;                    % Stop the PLM debug UI
 plm.PauseUI = @PauseUI;                    % Pause the PLM debug UI
 plm.ResumeUI = @ResumeUI;                    % Resume the PLM UI
+plm.ResizeFrameStore = @ResizeFrameStore;    % Change MAX_FRAMES without restarting the UI
 plm.SetLookupTable = @SetLookupTable;    % Set the lookup table for phase levels
 plm.SetFrame = @SetFrame;                % Set a specific frame to display
 plm.SetPhaseMap = @SetPhaseMap;          % Set the phase map for holograms
 plm.BitpackHolograms = @BitpackHolograms;  % Create and bit-pack holograms from phase data
 plm.BitpackHologramsGPU = @BitpackHologramsGPU;
+plm.SetBitpackThreads = @SetBitpackThreads;  % Number of CPU bitpacking threads (0 = all)
+plm.SetBitpackAffinity = @SetBitpackAffinity;  % Pin CPU bitpacking threads to cores
 plm.BitpackHologramsGPUPtr = @BitpackHologramsGPUPtr;
+plm.BitpackAndInsert = @BitpackAndInsert;  % Up to 24 holograms straight into a frame slot
 plm.BitpackAndInsertGPU = @BitpackAndInsertGPU;
+plm.BitpackAndInsertBatch = @BitpackAndInsertBatch;  % Any number of holograms, 24 per frame
+plm.UpdateHologramPlane = @UpdateHologramPlane;  % Replace one of the 24 holograms of a stored frame
+plm.BitpackLevels = @BitpackLevels;      % Bit-pack holograms given as levels 0-15
+plm.PackLevels = @PackLevels;            % Pack levels two per byte for BitpackLevels
 plm.SetWindowedMode = @SetWindowed;
 plm.Cleanup = @cleanup;                  % Unload the library and cleanup resources
 
@@ -99,9 +107,19 @@ plm.Configure = @Configure;
         calllib('plmctrl', 'SetWindowed', windowed_mode);
     end
 
-    function SetFrameSequence(sequence)
+    function SetFrameSequence(sequence, dwell)
+        % dwell (optional): vsyncs each step is held for, at least 1
         validateattributes(sequence, {'numeric'}, {'vector', 'integer', 'nonnegative'});
-        calllib('plmctrl', 'SetFrameSequence', libpointer('uint64Ptr', sequence), length(sequence));
+        if nargin < 2
+            if ~calllib('plmctrl', 'SetFrameSequence', libpointer('uint64Ptr', sequence), length(sequence))
+                error('SetFrameSequence failed');
+            end
+            return;
+        end
+        validateattributes(dwell, {'numeric'}, {'vector', 'integer', 'positive', 'numel', numel(sequence)});
+        if ~calllib('plmctrl', 'SetFrameSequenceDwell', libpointer('uint64Ptr', sequence), libpointer('uint32Ptr', dwell), length(sequence))
+            error('SetFrameSequenceDwell failed');
+        end
     end
 
     function StartSequence(holograms_to_display)
@@ -109,6 +127,17 @@ plm.Configure = @Configure;
         calllib('plmctrl', 'StartSequence', holograms_to_display);
     end
 
+    function status = GetSequenceStatus()
+        % Sequencer state as of the last vsync, never blocks the render loop
+        ptr = libpointer('int64Ptr', zeros(1, 8, 'int64'));
+        if ~calllib('plmctrl', 'GetSequenceStatus', ptr)
+            error('GetSequenceStatus failed');
+        end
+        v = double(ptr.Value);
+        status = struct('mode', v(1), 'active', v(2), 'frames_to_play', v(3), 'frames_in_sequence', v(4), ...
+            'frame_index', v(5), 'buffer_index', v(6), 'slot', v(7), 'vsync', v(8));
+    end
+
     function StopUI()
         calllib('plmctrl', 'StopUI');
     end
@@ -121,6 +150,25 @@ plm.Configure = @Configure;
         calllib('plmctrl', 'ResumeUI');
     end
 
+    function state = GetUIState()
+        % 'idle', 'playing', 'paused' or 'draining'
+        states = {'idle', 'playing', 'paused', 'draining'};
+        state = states{calllib('plmctrl', 'GetUIState') + 1};
+    end
+
+    function ms = GetResumeLatency()
+        % Time from the last ResumeUI to the next present
+        ms = calllib('plmctrl', 'GetResumeLatency');
+    end
+
+    function res = ResizeFrameStore(max_frames)
+        validateattributes(max_frames, {'numeric'}, {'scalar', 'positive', 'integer'});
+        res = calllib('plmctrl', 'ResizeFrameStore', max_frames);
+        if res
+            plm.MAX_FRAMES = max_frames;
+        end
+    end
+
 % Function to set the lookup table for phase levels
     function SetLookupTable(phase_levels)
         validateattributes(phase_levels, {'single'}, {'vector', 'numel', 17});
@@ -139,22 +187,59 @@ plm.Configure = @Configure;
 
 % Function to create and bit-pack holograms from phase data
     function frame = BitpackHolograms(phase)
-        validateattributes(phase, {'single'}, {'3d', '>=', 0, '<=', 1'});
+        if isfloat(phase)
+            validateattributes(phase, {'single', 'double'}, {'3d', '>=', 0, '<=', 1'});
+        else
+            validateattributes(phase, {'uint8', 'uint16'}, {'3d'});
+        end
         % Initialize an empty array to hold the bit-packed hologram
         numPatterns = size(phase, 3);
         frame = zeros(4*2*plm.N, 2*plm.M, 'uint8');
 
         % Prepare pointers to the phase data and the hologram array
-        phasePtr = libpointer('singlePtr', phase);
+        [phasePtr, functionName, layout] = PhasePointer(phase, 'BitpackHolograms');
         hologramPtr = libpointer('uint8Ptr', frame);
 
         % Bit-pack the holograms using the library function
-        calllib('plmctrl', 'BitpackHolograms', phasePtr, hologramPtr, plm.N, plm.M, numPatterns);
+        calllib('plmctrl', functionName, phasePtr, hologramPtr, plm.N, plm.M, numPatterns, layout{:});
 
         % Retrieve the bit-packed hologram
         frame = hologramPtr.Value;
     end
 
+% single phases go to functionName itself, uint8 (v / 255) and uint16 (v / 65535) ones to
+% its U8 and U16 variants, without converting them. double phases go to the Double variant,
+% which reads the array in place: an M x N x numHolograms array (rows x columns, as MATLAB
+% images are) is passed as column-major, an N x M x numHolograms one as row-major. layout
+% holds the extra arguments of the Double variant.
+    function [phasePtr, functionName, layout] = PhasePointer(phase, functionName)
+        layout = {};
+        switch class(phase)
+            case 'double'
+                phasePtr = phase;
+                functionName = [functionName 'Double'];
+                columnMajor = size(phase, 1) == plm.M && size(phase, 2) == plm.N;
+                layout = {int32(columnMajor), uint64(0)};
+            case 'uint8'
+                phasePtr = libpointer('uint8Ptr', phase);
+                functionName = [functionName 'U8'];
+            case 'uint16'
+                phasePtr = libpointer('uint16Ptr', phase);
+                functionName = [functionName 'U16'];
+            otherwise
+                phasePtr = libpointer('singlePtr', phase);
+        end
+    end
+
+    function SetBitpackThreads(num_threads)
+        validateattributes(num_threads, {'numeric'}, {'scalar', 'nonnegative', 'integer'});
+        calllib('plmctrl', 'SetBitpackThreads', uint32(num_threads));
+    end
+
+    function SetBitpackAffinity(pin)
+        calllib('plmctrl', 'SetBitpackAffinity', logical(pin));
+    end
+
 % Function to create and bit-pack holograms from phase data
     function frame = BitpackHologramsGPU(phase)
         %         validateattributes(phase, {'single'}, {'3d', '>=', 0, '<=', 1'});
@@ -163,11 +248,11 @@ plm.Configure = @Configure;
         frame = zeros(4*2*plm.N, 2*plm.M, 'uint8');
 
         % Prepare pointers to the phase data and the hologram array
-        phasePtr = libpointer('singlePtr', phase);
+        [phasePtr, functionName, layout] = PhasePointer(phase, 'BitpackHolograms');
         framePtr = libpointer('uint8Ptr', frame);
 
         % Bit-pack the holograms using the library function
-        res = calllib('plmctrl', 'BitpackHologramsGPU', phasePtr, framePtr, plm.N, plm.M, numHolograms);
+        res = calllib('plmctrl', [functionName 'GPU'], phasePtr, framePtr, plm.N, plm.M, numHolograms, layout{:});
         fprintf("Bitpacked: %d\n", res);
 
         % Retrieve the bit-packed hologram
@@ -196,6 +281,79 @@ plm.Configure = @Configure;
         res = calllib('plmctrl', 'BitpackAndInsertGPU', phasePtr, plm.N, plm.M, numPatterns, offset);
     end
 
+% Bit-packs up to 24 holograms on the CPU straight into frame slot offset and shows it
+    function res = BitpackAndInsert(phase, offset)
+        numPatterns = size(phase, 3);
+        phasePtr = libpointer('singlePtr', single(phase));
+
+        res = calllib('plmctrl', 'BitpackAndInsert', phasePtr, plm.N, plm.M, numPatterns, offset);
+    end
+
+% Bit-packs size(phase, 3) holograms, 24 per frame, into consecutive frames from offset.
+% Set useGPU to pack them with the compute shader instead of the CPU threads.
+    function res = BitpackAndInsertBatch(phase, offset, useGPU)
+        if nargin < 3
+            useGPU = false;
+        end
+        numPatterns = size(phase, 3);
+        phasePtr = libpointer('singlePtr', single(phase));
+
+        if useGPU
+            res = calllib('plmctrl', 'BitpackAndInsertBatchGPU', phasePtr, plm.N, plm.M, numPatterns, offset);
+        else
+            res = calllib('plmctrl', 'BitpackAndInsertBatch', phasePtr, plm.N, plm.M, numPatterns, offset);
+        end
+    end
+
+% Replaces hologram planeIndex (0-23) of the frame in slot with a single phase pattern,
+% keeping the frame's other 23 holograms
+    function res = UpdateHologramPlane(slot, planeIndex, phase, useGPU)
+        if nargin < 4
+            useGPU = false;
+        end
+        phasePtr = libpointer('singlePtr', single(phase));
+
+        if useGPU
+            res = calllib('plmctrl', 'UpdateHologramPlaneGPU', slot, planeIndex, phasePtr);
+        else
+            res = calllib('plmctrl', 'UpdateHologramPlane', slot, planeIndex, phasePtr);
+        end
+    end
+
+% Packs uint8 levels two per byte, element e in the low nibble of byte e/2 (0-based) when e is even
+    function packed = PackLevels(levels)
+        flat = uint8(levels(:));
+        if mod(numel(flat), 2)
+            flat(end + 1) = 0;
+        end
+        packed = bitor(bitand(flat(1:2:end), 15), bitshift(flat(2:2:end), 4));
+    end
+
+% Bit-packs holograms already quantised to levels 0-15, skipping the lookup-table.
+% levels is an N x M x numHolograms uint8 array, or the output of PackLevels with numHolograms given.
+    function frame = BitpackLevels(levels, numHolograms, useGPU)
+        validateattributes(levels, {'uint8'}, {});
+        if nargin < 3
+            useGPU = false;
+        end
+        if nargin < 2 || isempty(numHolograms)
+            levelFormat = 0;
+            numHolograms = size(levels, 3);
+        else
+            levelFormat = 1;
+        end
+        frame = zeros(4*2*plm.N, 2*plm.M, 'uint8');
+
+        levelsPtr = libpointer('uint8Ptr', levels);
+        framePtr = libpointer('uint8Ptr', frame);
+        if useGPU
+            calllib('plmctrl', 'BitpackLevelsGPU', levelsPtr, levelFormat, framePtr, plm.N, plm.M, numHolograms);
+        else
+            calllib('plmctrl', 'BitpackLevels', levelsPtr, levelFormat, framePtr, plm.N, plm.M, numHolograms);
+        end
+        frame = framePtr.Value;
+    end
+
     function res = SetSource(source, portWidth)
         validateattributes(source, {'numeric'}, {'scalar', 'nonnegative', 'integer'});
         validateattributes(portWidth, {'numeric'}, {'scalar', 'nonnegative', 'integer'});
@@ -2,6 +2,42 @@ import ctypes
 import numpy as np
 import time
 
+def _slot_view(ptr, pitch, N, M):
+    """(2M, 2N, 3) uint8 view of a leased frame slot, rows pitch bytes apart."""
+    if not ptr:
+        raise ValueError("slot doesn't exist or is already leased")
+    rows = np.ctypeslib.as_array(ptr, shape=(2 * M, pitch))
+    return rows[:, :3 * 2 * N].reshape(2 * M, 2 * N, 3)
+
+
+def _phase_view(phase, N, M, hologram_axis=0):
+    """View phase as (holograms, M rows, N pixels) and return it with its (pixel, row, plane) element strides.
+
+    Slices, transposes and other views are read in place through their strides. Contiguous arrays
+    of another shape are taken in memory order, as they always have been.
+    """
+    phase = np.moveaxis(phase, hologram_axis, 0)
+    if phase.shape[1:] != (M, N):
+        if not phase.flags.c_contiguous or phase.size != phase.shape[0] * N * M:
+            raise ValueError("phase must be shaped (holograms, M, N) along hologram_axis")
+        return phase, (1, N, N * M)
+    if any(stride % phase.itemsize for stride in phase.strides):
+        raise ValueError("phase strides must be whole elements")
+    plane, row, pixel = (stride // phase.itemsize for stride in phase.strides)
+    return phase, (pixel, row, plane)
+
+
+SEQUENCE_STATUS_FIELDS = ('mode', 'active', 'frames_to_play', 'frames_in_sequence',
+                          'frame_index', 'buffer_index', 'slot', 'vsync')
+
+
+def _sequence_status(get_status, *args):
+    """Sequencer snapshot as a dict, see GetSequenceStatus. Never blocks the render loop."""
+    status = (ctypes.c_int64 * len(SEQUENCE_STATUS_FIELDS))()
+    if not get_status(*args, status):
+        raise RuntimeError("failed to read the sequence status")
+    return dict(zip(SEQUENCE_STATUS_FIELDS, status))
+
 class PLMController:
     def __init__(self, MAX_FRAMES:int, width:int, height:int, dll_path='plmctrl.dll', x0:int = 1920, y0:int = 0 ):
         """
@@ -29,8 +65,13 @@ class PLMController:
         self.lib.StartUI.argtypes = [ctypes.c_int]
         self.lib.InsertPLMFrame.argtypes = [ctypes.POINTER(ctypes.c_uint8), ctypes.c_int, ctypes.c_int, ctypes.c_int]
         self.lib.InsertPLMFrame.restype = ctypes.c_int
-        self.lib.SetFrameSequence.argtypes = [ctypes.POINTER(ctypes.c_uint64), ctypes.c_int]
+        self.lib.SetFrameSequence.argtypes = [ctypes.POINTER(ctypes.c_uint64), ctypes.c_uint64]
+        self.lib.SetFrameSequence.restype = ctypes.c_bool
+        self.lib.SetFrameSequenceDwell.argtypes = [ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint32), ctypes.c_uint64]
+        self.lib.SetFrameSequenceDwell.restype = ctypes.c_bool
         self.lib.StartSequence.argtypes = [ctypes.c_int]
+        self.lib.GetSequenceStatus.argtypes = [ctypes.POINTER(ctypes.c_int64)]
+        self.lib.GetSequenceStatus.restype = ctypes.c_bool
         self.lib.SetLookupTable.argtypes = [ctypes.POINTER(ctypes.c_float)]
         self.lib.SetPLMFrame.argtypes = [ctypes.c_int]
         self.lib.SetPhaseMap.argtypes = [ctypes.POINTER(ctypes.c_int32)]
@@ -42,6 +83,46 @@ class PLMController:
                                                  ctypes.c_int, ctypes.c_int, ctypes.c_int]
         self.lib.BitpackAndInsertGPU.argtypes = [ctypes.POINTER(ctypes.c_float), 
                                                  ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int]
+        for name, ctype in (('U8', ctypes.c_uint8), ('U16', ctypes.c_uint16)):
+            for suffix in ('', 'GPU'):
+                function = getattr(self.lib, 'BitpackHolograms' + name + suffix)
+                function.argtypes = [ctypes.POINTER(ctype), ctypes.POINTER(ctypes.c_uint8), ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int]
+                function.restype = ctypes.c_bool
+        for name, ctype in (('BitpackHologramsStrided', ctypes.c_float), ('BitpackHologramsDoubleStrided', ctypes.c_double)):
+            for suffix in ('', 'GPU'):
+                function = getattr(self.lib, name + suffix)
+                function.argtypes = [ctypes.POINTER(ctype), ctypes.POINTER(ctypes.c_uint8), ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int,
+                                     ctypes.c_int64, ctypes.c_int64, ctypes.c_int64]
+                function.restype = ctypes.c_bool
+        self.lib.BitpackLevels.argtypes = [ctypes.POINTER(ctypes.c_uint8), ctypes.c_int, ctypes.POINTER(ctypes.c_uint8),
+                                           ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int]
+        self.lib.BitpackLevels.restype = ctypes.c_bool
+        self.lib.BitpackLevelsGPU.argtypes = [ctypes.POINTER(ctypes.c_uint8), ctypes.c_int, ctypes.POINTER(ctypes.c_uint8),
+                                              ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int]
+        self.lib.BitpackLevelsGPU.restype = ctypes.c_bool
+        self.lib.BitpackAndInsert.argtypes = [ctypes.POINTER(ctypes.c_float),
+                                              ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int, ctypes.c_uint64]
+        self.lib.BitpackAndInsert.restype = ctypes.c_bool
+        self.lib.AcquireFrameSlot.argtypes = [ctypes.c_uint64, ctypes.POINTER(ctypes.c_uint64)]
+        self.lib.AcquireFrameSlot.restype = ctypes.POINTER(ctypes.c_uint8)
+        self.lib.CommitFrameSlot.argtypes = [ctypes.c_uint64]
+        self.lib.CommitFrameSlot.restype = ctypes.c_bool
+        self.lib.ResizeFrameStore.argtypes = [ctypes.c_uint64]
+        self.lib.GetUIState.restype = ctypes.c_int
+        self.lib.GetResumeLatency.restype = ctypes.c_double
+        self.lib.ResizeFrameStore.restype = ctypes.c_bool
+        self.lib.BitpackAndInsertBatch.argtypes = [ctypes.POINTER(ctypes.c_float),
+                                                   ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64]
+        self.lib.BitpackAndInsertBatch.restype = ctypes.c_bool
+        self.lib.BitpackAndInsertBatchGPU.argtypes = [ctypes.POINTER(ctypes.c_float),
+                                                      ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64]
+        self.lib.BitpackAndInsertBatchGPU.restype = ctypes.c_bool
+        self.lib.UpdateHologramPlane.argtypes = [ctypes.c_uint64, ctypes.c_int, ctypes.POINTER(ctypes.c_float)]
+        self.lib.UpdateHologramPlane.restype = ctypes.c_bool
+        self.lib.UpdateHologramPlaneGPU.argtypes = [ctypes.c_uint64, ctypes.c_int, ctypes.POINTER(ctypes.c_float)]
+        self.lib.UpdateHologramPlaneGPU.restype = ctypes.c_bool
+        self.lib.SetBitpackThreads.argtypes = [ctypes.c_uint32]
+        self.lib.SetBitpackAffinity.argtypes = [ctypes.c_bool]
 
         # PLM USB comms functions
         self.lib.SetSource.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
@@ -133,8 +214,23 @@ class PLMController:
         res = self.lib.InsertPLMFrame(frames_ptr, num_frames, offset, format)
         return res
 
-    def set_frame_sequence(self, sequence):
-        """Set the sequence of frames for display."""
+    def acquire_frame_slot(self, slot):
+        """Lease frame slot for writing in place. Returns a (2M, 2N, 3) uint8 view of its RGB data,
+        valid until commit_frame_slot(slot). The slot isn't uploaded until then: if the sequence
+        reaches it, the PLM keeps showing the frame before it, while sequence_status() reports
+        the leased slot."""
+        pitch = ctypes.c_uint64()
+        return _slot_view(self.lib.AcquireFrameSlot(slot, ctypes.byref(pitch)), pitch.value, self.N, self.M)
+
+    def commit_frame_slot(self, slot):
+        """End the lease on frame slot and publish what was written into it."""
+        return self.lib.CommitFrameSlot(slot)
+
+    def set_frame_sequence(self, sequence, dwell=None):
+        """Set the sequence of frames for display, any length, as frame-store indices.
+
+        dwell optionally gives the number of vsyncs each step is held for (at least 1).
+        """
         if not isinstance(sequence, np.ndarray) or not np.issubdtype(sequence.dtype, np.integer) or sequence.ndim != 1:
             raise ValueError("sequence must be a 1D numpy array of integers")
         if np.any(sequence < 0):
@@ -143,11 +239,23 @@ class PLMController:
         if not sequence.flags['C_CONTIGUOUS']:
             sequence = np.ascontiguousarray(sequence)
 
-        if len(sequence) < self.MAX_FRAMES:
-            raise ValueError(f"sequence length must be {self.MAX_FRAMES}")
-        
-        sequence_ptr = sequence.astype(np.uint64).ctypes.data_as(ctypes.POINTER(ctypes.c_uint64))
-        self.lib.SetFrameSequence(sequence_ptr, len(sequence))
+        # The sequence can be longer than the frame store and revisit its frames
+        if len(sequence) == 0 or np.any(sequence >= self.MAX_FRAMES):
+            raise ValueError(f"sequence must be non-empty and refer to frames below {self.MAX_FRAMES}")
+        
+        sequence = sequence.astype(np.uint64)
+        sequence_ptr = sequence.ctypes.data_as(ctypes.POINTER(ctypes.c_uint64))
+        # Fails when the sequencer's command queue is full
+        if dwell is None:
+            if not self.lib.SetFrameSequence(sequence_ptr, len(sequence)):
+                raise RuntimeError("SetFrameSequence failed")
+            return
+
+        dwell = np.ascontiguousarray(dwell, dtype=np.uint32)
+        if dwell.shape != sequence.shape or np.any(dwell == 0):
+            raise ValueError("dwell must give at least 1 vsync for every step of the sequence")
+        if not self.lib.SetFrameSequenceDwell(sequence_ptr, dwell.ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)), len(sequence)):
+            raise RuntimeError("SetFrameSequenceDwell failed")
 
     def start_sequence(self, holograms_to_display):
         """Start displaying the sequence of frames."""
@@ -156,17 +264,40 @@ class PLMController:
         
         self.lib.StartSequence(holograms_to_display)
 
+    def sequence_status(self):
+        """State of the sequencer as of the last vsync, safe to poll from any thread."""
+        return _sequence_status(self.lib.GetSequenceStatus)
+
     def pause_ui(self):
         """Pause the PLM UI."""
         self.lib.PauseUI()
         
     def resume_ui(self):
-        """Pause the PLM UI."""
+        """Resume the PLM UI."""
         self.lib.ResumeUI()
 
+    UI_STATES = ('idle', 'playing', 'paused', 'draining')
+
+    def ui_state(self):
+        """State of the render loop: 'idle', 'playing', 'paused' or 'draining'."""
+        return self.UI_STATES[self.lib.GetUIState()]
+
+    def resume_latency(self):
+        """Time from the last resume_ui to the next present, in ms."""
+        return self.lib.GetResumeLatency()
+
     def stop_ui(self):
         """Stop the PLM UI."""
         self.lib.StopUI()
+
+    def resize_frame_store(self, max_frames):
+        """Change the number of frames the PLM holds without restarting the UI. Stored frames are kept where they fit."""
+        if not isinstance(max_frames, int) or max_frames <= 0:
+            raise ValueError("max_frames must be a positive integer")
+        res = self.lib.ResizeFrameStore(max_frames)
+        if res:
+            self.MAX_FRAMES = max_frames
+        return res
         
     def play(self):
         """Equivalent to pressing the Play button on PLM UI."""
@@ -208,38 +339,69 @@ class PLMController:
         res = self.lib.SetPhaseMap(phase_map_ptr)
         return res
 
-    def bitpack_holograms(self, phase):
-        """Create and bit-pack holograms from phase data."""
-        if not isinstance(phase, np.ndarray) or phase.dtype != np.float32 or phase.ndim != 3:
-            raise ValueError("phase must be a 3D numpy array of float32")
+    def _bitpack_fixed_point(self, phase, gpu):
+        """uint8 (v / 255) and uint16 (v / 65535) phases go to their own entry points, without a float copy."""
+        name = 'BitpackHologramsU8' if phase.dtype == np.uint8 else 'BitpackHologramsU16'
+        ctype = ctypes.c_uint8 if phase.dtype == np.uint8 else ctypes.c_uint16
+        phase = np.ascontiguousarray(phase)
+
+        frame = np.empty((2 * self.M, 4 * 2 * self.N), dtype=np.uint8)
+        getattr(self.lib, name + ('GPU' if gpu else ''))(phase.ctypes.data_as(ctypes.POINTER(ctype)),
+                                                          frame.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)),
+                                                          self.N, self.M, phase.shape[0])
+        return frame
+
+    def _bitpack_strided(self, phase, hologram_axis, gpu):
+        """float32 and float64 phases are read in place through their strides, without a contiguous copy."""
+        phase, strides = _phase_view(phase, self.N, self.M, hologram_axis)
+        name = 'BitpackHologramsStrided' if phase.dtype == np.float32 else 'BitpackHologramsDoubleStrided'
+        ctype = ctypes.c_float if phase.dtype == np.float32 else ctypes.c_double
+
+        frame = np.empty((2 * self.M, 4 * 2 * self.N), dtype=np.uint8)
+        getattr(self.lib, name + ('GPU' if gpu else ''))(phase.ctypes.data_as(ctypes.POINTER(ctype)),
+                                                          frame.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)),
+                                                          self.N, self.M, phase.shape[0], *strides)
+        return frame
+
+    def bitpack_holograms(self, phase, hologram_axis=0):
+        """Create and bit-pack holograms from phase data: float32/float64 in [0, 1], or uint8/uint16 fixed-point.
+
+        phase is shaped (holograms, M, N), or has its holograms along hologram_axis. Float views
+        (slices, transposes) are read in place.
+        """
+        if isinstance(phase, np.ndarray) and phase.dtype in (np.uint8, np.uint16) and phase.ndim == 3:
+            return self._bitpack_fixed_point(np.moveaxis(phase, hologram_axis, 0), gpu=False)
+        if not isinstance(phase, np.ndarray) or phase.dtype not in (np.float32, np.float64) or phase.ndim != 3:
+            raise ValueError("phase must be a 3D numpy array of float32, float64, uint8 or uint16")
         if np.any(phase < 0) or np.any(phase > 1):
             raise ValueError("phase values must be between 0 and 1")
-        
-        num_patterns = phase.shape[0]
-        frame = np.zeros((2 * self.M, 4 * 2 * self.N), dtype=np.uint8)
-        
-        phase_ptr = phase.ctypes.data_as(ctypes.POINTER(ctypes.c_float))
-        frame_ptr = frame.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8))
-        
-        self.lib.BitpackHolograms(phase_ptr, frame_ptr, self.N, self.M, num_patterns)
-        return frame
+
+        return self._bitpack_strided(phase, hologram_axis, gpu=False)
     
-    def bitpack_holograms_gpu(self, phase):
-        """Create and bit-pack holograms from phase data. This function uses compute shaders and runs on the GPU."""
-        if not isinstance(phase, np.ndarray) or phase.dtype != np.float32 or phase.ndim != 3:
-            raise ValueError("phase must be a 3D numpy array of float32")
+    def set_bitpack_threads(self, num_threads):
+        """Set the number of threads used by bitpack_holograms. 0 uses all hardware threads (default)."""
+        if not isinstance(num_threads, int) or num_threads < 0:
+            raise ValueError("num_threads must be a non-negative integer")
+
+        self.lib.SetBitpackThreads(num_threads)
+
+    def set_bitpack_affinity(self, pin):
+        """Pin each bitpacking thread to its own core (True) or let the OS schedule them (False)."""
+        if not isinstance(pin, bool):
+            raise ValueError("pin must be a boolean value")
+
+        self.lib.SetBitpackAffinity(pin)
+
+    def bitpack_holograms_gpu(self, phase, hologram_axis=0):
+        """Create and bit-pack holograms from phase data, see bitpack_holograms. This function uses compute shaders and runs on the GPU."""
+        if isinstance(phase, np.ndarray) and phase.dtype in (np.uint8, np.uint16) and phase.ndim == 3:
+            return self._bitpack_fixed_point(np.moveaxis(phase, hologram_axis, 0), gpu=True)
+        if not isinstance(phase, np.ndarray) or phase.dtype not in (np.float32, np.float64) or phase.ndim != 3:
+            raise ValueError("phase must be a 3D numpy array of float32, float64, uint8 or uint16")
         if np.any(phase < 0) or np.any(phase > 1):
             raise ValueError("phase values must be between 0 and 1")
 
-        num_patterns = phase.shape[0]
-        frame = np.zeros((2 * self.M, 4 * 2 * self.N), dtype=np.uint8)
-        
-        phase_ptr = phase.ctypes.data_as(ctypes.POINTER(ctypes.c_float))
-        frame_ptr = frame.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8))
-        
-        self.lib.BitpackHologramsGPU(phase_ptr, frame_ptr, self.N, self.M, num_patterns)
-
-        return frame
+        return self._bitpack_strided(phase, hologram_axis, gpu=True)
     
     def bitpack_holograms_gpu_ptr(self, phase_ptr, frame_ptr, num_patterns):
         """Create and bit-pack holograms from phase data. This function uses compute shaders and runs on the GPU."""
@@ -268,6 +430,76 @@ class PLMController:
         res = self.lib.BitpackAndInsertGPU(phase_ptr, self.N, self.M, num_patterns, offset)
         return res
 
+    def bitpack_and_insert(self, phase, offset):
+        """Bit-pack up to 24 holograms on the CPU straight into frame slot offset and show it.
+        The frame is written once, with no intermediate RGBA buffer."""
+        if not isinstance(phase, np.ndarray) or phase.dtype != np.float32 or phase.ndim != 3:
+            raise ValueError("phase must be a 3D numpy array of float32")
+        if not 1 <= phase.shape[0] <= 24:
+            raise ValueError("phase must hold between 1 and 24 holograms")
+        if not isinstance(offset, int) or offset < 0:
+            raise ValueError("offset must be a non-negative integer")
+        phase = np.ascontiguousarray(phase)
+
+        return self.lib.BitpackAndInsert(phase.ctypes.data_as(ctypes.POINTER(ctypes.c_float)), self.N, self.M, phase.shape[0], offset)
+
+    @staticmethod
+    def pack_levels(levels):
+        """Pack uint8 levels (0-15) two per byte, element e in the low nibble of byte e // 2 when e is even."""
+        flat = np.ascontiguousarray(levels, dtype=np.uint8).ravel()
+        if flat.size % 2:
+            flat = np.append(flat, np.uint8(0))
+        return (flat[0::2] & 0x0F) | (flat[1::2] << 4)
+
+    def bitpack_levels(self, levels, num_holograms=None, gpu=False):
+        """Bit-pack holograms that are already quantised to the 16 PLM levels, skipping the lookup-table.
+
+        Args:
+            levels (np.ndarray): uint8 levels of shape (num_holograms, height, width), or levels packed
+                two per byte by pack_levels, in which case num_holograms has to be given.
+            num_holograms (int): Number of holograms in nibble-packed levels.
+            gpu (bool): Pack with the compute shader instead of the CPU threads.
+        """
+        if not isinstance(levels, np.ndarray) or levels.dtype != np.uint8:
+            raise ValueError("levels must be a uint8 numpy array")
+        if levels.ndim == 3:
+            level_format, num_holograms = 0, levels.shape[0]
+        elif num_holograms is not None:
+            level_format = 1
+            if levels.size * 2 < num_holograms * self.N * self.M:
+                raise ValueError("levels holds fewer than num_holograms packed holograms")
+        else:
+            raise ValueError("levels must be 3D, or nibble-packed with num_holograms given")
+        levels = np.ascontiguousarray(levels)
+
+        frame = np.empty((2 * self.M, 4 * 2 * self.N), dtype=np.uint8)
+        bitpack = self.lib.BitpackLevelsGPU if gpu else self.lib.BitpackLevels
+        bitpack(levels.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)), level_format,
+                frame.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)), self.N, self.M, num_holograms)
+        return frame
+
+    def bitpack_and_insert_batch(self, phase, offset, gpu=False):
+        """Bit-pack any number of holograms, 24 per frame, and insert them into consecutive frames from offset.
+        Frames are packed in parallel on the CPU threads, or one after another with the compute shader if gpu is True."""
+        if not isinstance(phase, np.ndarray) or phase.dtype != np.float32 or phase.ndim != 3:
+            raise ValueError("phase must be a 3D numpy array of float32")
+        if not isinstance(offset, int) or offset < 0:
+            raise ValueError("offset must be a non-negative integer")
+        phase = np.ascontiguousarray(phase)
+
+        batch = self.lib.BitpackAndInsertBatchGPU if gpu else self.lib.BitpackAndInsertBatch
+        return batch(phase.ctypes.data_as(ctypes.POINTER(ctypes.c_float)), self.N, self.M, phase.shape[0], offset)
+
+    def update_hologram_plane(self, slot, plane_index, phase, gpu=False):
+        """Replace hologram plane_index (0-23) of the frame in slot with an (M, N) float32 phase array.
+        The other 23 holograms of the frame are kept, so changing one of them doesn't need a full repack."""
+        if not isinstance(phase, np.ndarray) or phase.dtype != np.float32 or phase.shape != (self.M, self.N):
+            raise ValueError(f"phase must be a numpy array of float32 with shape ({self.M}, {self.N})")
+        phase = np.ascontiguousarray(phase)
+
+        update = self.lib.UpdateHologramPlaneGPU if gpu else self.lib.UpdateHologramPlane
+        return update(slot, plane_index, phase.ctypes.data_as(ctypes.POINTER(ctypes.c_float)))
+
     # New methods for configuration
     def set_source(self, source, port_width):
         """Set the source and port width for the PLM."""
@@ -376,4 +608,238 @@ class PLMController:
     def cleanup(self):
         """Cleanup and unload the PLM library."""
         self.lib.StopUI()
-        # Library unloading is handled by Python at process exit
\ No newline at end of file
+        # Library unloading is handled by Python at process exit
+
+class PLMPipeline:
+    def __init__(self, controller:PLMController, num_frames:int, width:int = None, height:int = None):
+        """
+        Independent hologram pipeline (plm_handle) in the same plmctrl library.
+
+        It has its own lookup-table, phase map, bitpacking threads, frame store and sequence,
+        so several pipelines can pack and insert frames in parallel. Call start_ui() to show
+        it in the PLM window instead of the controller's default pipeline.
+
+        Args:
+            controller (PLMController): Controller whose library is used.
+            num_frames (int): Number of frames the pipeline's frame store holds.
+            width (int): Width of the holograms in pixels (default: the controller's).
+            height (int): Height of the holograms in pixels (default: the controller's).
+        """
+        self.lib = controller.lib
+        self.N = controller.N if width is None else width
+        self.M = controller.M if height is None else height
+        self.num_frames = num_frames
+
+        handle = ctypes.c_void_p
+        self.lib.PLM_Create.argtypes = [ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64]
+        self.lib.PLM_Create.restype = handle
+        self.lib.PLM_Destroy.argtypes = [handle]
+        self.lib.PLM_Destroy.restype = ctypes.c_bool
+        self.lib.PLM_StartUI.argtypes = [handle]
+        self.lib.PLM_SetLookupTable.argtypes = [handle, ctypes.POINTER(ctypes.c_float)]
+        self.lib.PLM_SetPhaseMap.argtypes = [handle, ctypes.POINTER(ctypes.c_int32)]
+        self.lib.PLM_SetPhaseMap.restype = ctypes.c_bool
+        self.lib.PLM_SetBitpackThreads.argtypes = [handle, ctypes.c_uint32]
+        self.lib.PLM_SetBitpackAffinity.argtypes = [handle, ctypes.c_bool]
+        self.lib.PLM_BitpackHolograms.argtypes = [handle, ctypes.POINTER(ctypes.c_float), ctypes.POINTER(ctypes.c_uint8),
+                                                  ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int]
+        self.lib.PLM_BitpackHolograms.restype = ctypes.c_bool
+        self.lib.PLM_BitpackHologramsU8.argtypes = [handle, ctypes.POINTER(ctypes.c_uint8), ctypes.POINTER(ctypes.c_uint8),
+                                                    ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int]
+        self.lib.PLM_BitpackHologramsU8.restype = ctypes.c_bool
+        self.lib.PLM_BitpackHologramsU16.argtypes = [handle, ctypes.POINTER(ctypes.c_uint16), ctypes.POINTER(ctypes.c_uint8),
+                                                     ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int]
+        self.lib.PLM_BitpackHologramsU16.restype = ctypes.c_bool
+        for name, ctype in (('PLM_BitpackHologramsStrided', ctypes.c_float), ('PLM_BitpackHologramsDoubleStrided', ctypes.c_double)):
+            function = getattr(self.lib, name)
+            function.argtypes = [handle, ctypes.POINTER(ctype), ctypes.POINTER(ctypes.c_uint8), ctypes.c_uint64, ctypes.c_uint64,
+                                 ctypes.c_int, ctypes.c_int64, ctypes.c_int64, ctypes.c_int64]
+            function.restype = ctypes.c_bool
+        self.lib.PLM_BitpackLevels.argtypes = [handle, ctypes.POINTER(ctypes.c_uint8), ctypes.c_int, ctypes.POINTER(ctypes.c_uint8),
+                                               ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int]
+        self.lib.PLM_BitpackLevels.restype = ctypes.c_bool
+        self.lib.PLM_BitpackAndInsertBatch.argtypes = [handle, ctypes.POINTER(ctypes.c_float),
+                                                       ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64]
+        self.lib.PLM_BitpackAndInsertBatch.restype = ctypes.c_bool
+        self.lib.PLM_BitpackAndInsertBatchGPU.argtypes = [handle, ctypes.POINTER(ctypes.c_float),
+                                                          ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64]
+        self.lib.PLM_BitpackAndInsertBatchGPU.restype = ctypes.c_bool
+        self.lib.PLM_UpdateHologramPlane.argtypes = [handle, ctypes.c_uint64, ctypes.c_int, ctypes.POINTER(ctypes.c_float)]
+        self.lib.PLM_UpdateHologramPlane.restype = ctypes.c_bool
+        self.lib.PLM_UpdateHologramPlaneGPU.argtypes = [handle, ctypes.c_uint64, ctypes.c_int, ctypes.POINTER(ctypes.c_float)]
+        self.lib.PLM_UpdateHologramPlaneGPU.restype = ctypes.c_bool
+        self.lib.PLM_InsertFrames.argtypes = [handle, ctypes.POINTER(ctypes.c_uint8), ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int]
+        self.lib.PLM_InsertFrames.restype = ctypes.c_bool
+        self.lib.PLM_GrabFrame.argtypes = [handle, ctypes.POINTER(ctypes.c_uint8), ctypes.c_uint64]
+        self.lib.PLM_GrabFrame.restype = ctypes.c_bool
+        self.lib.PLM_AcquireFrameSlot.argtypes = [handle, ctypes.c_uint64, ctypes.POINTER(ctypes.c_uint64)]
+        self.lib.PLM_AcquireFrameSlot.restype = ctypes.POINTER(ctypes.c_uint8)
+        self.lib.PLM_CommitFrameSlot.argtypes = [handle, ctypes.c_uint64]
+        self.lib.PLM_CommitFrameSlot.restype = ctypes.c_bool
+        self.lib.PLM_ResizeFrameStore.argtypes = [handle, ctypes.c_uint64]
+        self.lib.PLM_ResizeFrameStore.restype = ctypes.c_bool
+        self.lib.PLM_SetFrameSequence.argtypes = [handle, ctypes.POINTER(ctypes.c_uint64), ctypes.c_uint64]
+        self.lib.PLM_SetFrameSequence.restype = ctypes.c_bool
+        self.lib.PLM_SetFrameSequenceDwell.argtypes = [handle, ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint32), ctypes.c_uint64]
+        self.lib.PLM_SetFrameSequenceDwell.restype = ctypes.c_bool
+        self.lib.PLM_SetFrame.argtypes = [handle, ctypes.c_uint64]
+        self.lib.PLM_SetFrame.restype = ctypes.c_bool
+        self.lib.PLM_StartSequence.argtypes = [handle, ctypes.c_int]
+        self.lib.PLM_StartSequence.restype = ctypes.c_bool
+        self.lib.PLM_GetSequenceStatus.argtypes = [handle, ctypes.POINTER(ctypes.c_int64)]
+        self.lib.PLM_GetSequenceStatus.restype = ctypes.c_bool
+
+        self.handle = self.lib.PLM_Create(self.N, self.M, num_frames)
+
+    def start_ui(self):
+        """Show this pipeline in the PLM window."""
+        self.lib.PLM_StartUI(self.handle)
+
+    def set_lookup_table(self, phase_levels):
+        """Set the lookup table for phase levels."""
+        if not isinstance(phase_levels, np.ndarray) or phase_levels.dtype != np.float32 or phase_levels.ndim != 1:
+            raise ValueError("phase_levels must be a 1D numpy array of float32")
+        phase_levels = np.ascontiguousarray(phase_levels)
+        self.lib.PLM_SetLookupTable(self.handle, phase_levels.ctypes.data_as(ctypes.POINTER(ctypes.c_float)))
+
+    def set_phase_map(self, phase_map):
+        """Set the phase map for holograms."""
+        if not isinstance(phase_map, np.ndarray) or not np.issubdtype(phase_map.dtype, np.integer) or phase_map.ndim != 2:
+            raise ValueError("phase_map must be a 2D numpy array of integers")
+        phase_map = np.ascontiguousarray(phase_map, dtype=np.int32)
+        return self.lib.PLM_SetPhaseMap(self.handle, phase_map.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)))
+
+    def set_bitpack_threads(self, num_threads):
+        """Set the number of threads used by bitpack_holograms. 0 uses all hardware threads (default)."""
+        if not isinstance(num_threads, int) or num_threads < 0:
+            raise ValueError("num_threads must be a non-negative integer")
+        self.lib.PLM_SetBitpackThreads(self.handle, num_threads)
+
+    def set_bitpack_affinity(self, pin):
+        """Pin each bitpacking thread to its own core (True) or let the OS schedule them (False)."""
+        if not isinstance(pin, bool):
+            raise ValueError("pin must be a boolean value")
+        self.lib.PLM_SetBitpackAffinity(self.handle, pin)
+
+    def bitpack_holograms(self, phase, hologram_axis=0):
+        """Create and bit-pack holograms from phase data on the CPU, see PLMController.bitpack_holograms."""
+        functions = {np.dtype(np.float32): ('PLM_BitpackHologramsStrided', ctypes.c_float),
+                     np.dtype(np.float64): ('PLM_BitpackHologramsDoubleStrided', ctypes.c_double),
+                     np.dtype(np.uint8): ('PLM_BitpackHologramsU8', ctypes.c_uint8),
+                     np.dtype(np.uint16): ('PLM_BitpackHologramsU16', ctypes.c_uint16)}
+        if not isinstance(phase, np.ndarray) or phase.dtype not in functions or phase.ndim != 3:
+            raise ValueError("phase must be a 3D numpy array of float32, float64, uint8 or uint16")
+        name, ctype = functions[phase.dtype]
+
+        frame = np.empty((2 * self.M, 4 * 2 * self.N), dtype=np.uint8)
+        frame_ptr = frame.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8))
+        if phase.dtype in (np.float32, np.float64):
+            phase, strides = _phase_view(phase, self.N, self.M, hologram_axis)
+            getattr(self.lib, name)(self.handle, phase.ctypes.data_as(ctypes.POINTER(ctype)), frame_ptr,
+                                    self.N, self.M, phase.shape[0], *strides)
+        else:
+            phase = np.ascontiguousarray(np.moveaxis(phase, hologram_axis, 0))
+            getattr(self.lib, name)(self.handle, phase.ctypes.data_as(ctypes.POINTER(ctype)), frame_ptr,
+                                    self.N, self.M, phase.shape[0])
+        return frame
+
+    def bitpack_levels(self, levels, num_holograms=None):
+        """Bit-pack holograms given as levels on the CPU, see PLMController.bitpack_levels."""
+        if not isinstance(levels, np.ndarray) or levels.dtype != np.uint8:
+            raise ValueError("levels must be a uint8 numpy array")
+        if levels.ndim == 3:
+            level_format, num_holograms = 0, levels.shape[0]
+        elif num_holograms is not None:
+            level_format = 1
+            if levels.size * 2 < num_holograms * self.N * self.M:
+                raise ValueError("levels holds fewer than num_holograms packed holograms")
+        else:
+            raise ValueError("levels must be 3D, or nibble-packed with num_holograms given")
+        levels = np.ascontiguousarray(levels)
+
+        frame = np.empty((2 * self.M, 4 * 2 * self.N), dtype=np.uint8)
+        self.lib.PLM_BitpackLevels(self.handle, levels.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)), level_format,
+                                   frame.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)), self.N, self.M, num_holograms)
+        return frame
+
+    def bitpack_and_insert_batch(self, phase, offset, gpu=False):
+        """Bit-pack any number of holograms, 24 per frame, into consecutive frames of the pipeline from offset."""
+        if not isinstance(phase, np.ndarray) or phase.dtype != np.float32 or phase.ndim != 3:
+            raise ValueError("phase must be a 3D numpy array of float32")
+        phase = np.ascontiguousarray(phase)
+
+        batch = self.lib.PLM_BitpackAndInsertBatchGPU if gpu else self.lib.PLM_BitpackAndInsertBatch
+        return batch(self.handle, phase.ctypes.data_as(ctypes.POINTER(ctypes.c_float)), self.N, self.M, phase.shape[0], offset)
+
+    def update_hologram_plane(self, slot, plane_index, phase, gpu=False):
+        """Replace hologram plane_index (0-23) of the pipeline's frame in slot with an (M, N) float32 phase array."""
+        if not isinstance(phase, np.ndarray) or phase.dtype != np.float32 or phase.shape != (self.M, self.N):
+            raise ValueError(f"phase must be a numpy array of float32 with shape ({self.M}, {self.N})")
+        phase = np.ascontiguousarray(phase)
+
+        update = self.lib.PLM_UpdateHologramPlaneGPU if gpu else self.lib.PLM_UpdateHologramPlane
+        return update(self.handle, slot, plane_index, phase.ctypes.data_as(ctypes.POINTER(ctypes.c_float)))
+
+    def insert_frames(self, frames, offset, format):
+        """Insert RGB (format = 0) or RGBA (format = 1) frames into the pipeline's frame store, starting at offset."""
+        if not isinstance(frames, np.ndarray) or frames.dtype != np.uint8:
+            raise ValueError("frames must be a uint8 numpy array")
+        if frames.ndim == 2:
+            frames = frames[np.newaxis, :, :]
+        elif frames.ndim != 3:
+            raise ValueError("frames must be either a 2D or 3D numpy array")
+        frames = np.ascontiguousarray(frames)
+
+        return self.lib.PLM_InsertFrames(self.handle, frames.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)),
+                                         frames.shape[0], offset, format)
+
+    def grab_frame(self, index):
+        """Read back a stored frame as RGBA."""
+        frame = np.empty((2 * self.M, 4 * 2 * self.N), dtype=np.uint8)
+        if not self.lib.PLM_GrabFrame(self.handle, frame.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)), index):
+            raise ValueError("index exceeds the number of frames")
+        return frame
+
+    def acquire_frame_slot(self, slot):
+        """Lease frame slot for writing in place, as a (2M, 2N, 3) uint8 view of its RGB data."""
+        pitch = ctypes.c_uint64()
+        return _slot_view(self.lib.PLM_AcquireFrameSlot(self.handle, slot, ctypes.byref(pitch)), pitch.value, self.N, self.M)
+
+    def commit_frame_slot(self, slot):
+        """End the lease on frame slot and publish what was written into it."""
+        return self.lib.PLM_CommitFrameSlot(self.handle, slot)
+
+    def set_frame_sequence(self, sequence, dwell=None):
+        """Set the sequence of frames for display, optionally holding each step for dwell vsyncs."""
+        sequence = np.ascontiguousarray(sequence, dtype=np.uint64)
+        sequence_ptr = sequence.ctypes.data_as(ctypes.POINTER(ctypes.c_uint64))
+        if dwell is None:
+            return self.lib.PLM_SetFrameSequence(self.handle, sequence_ptr, len(sequence))
+        dwell = np.ascontiguousarray(dwell, dtype=np.uint32)
+        if dwell.shape != sequence.shape:
+            raise ValueError("dwell must have one entry per step of the sequence")
+        return self.lib.PLM_SetFrameSequenceDwell(self.handle, sequence_ptr, dwell.ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)), len(sequence))
+
+    def set_frame(self, frame):
+        """Set a specific frame to display."""
+        return self.lib.PLM_SetFrame(self.handle, frame)
+
+    def start_sequence(self, holograms_to_display):
+        """Start displaying the sequence of frames."""
+        return self.lib.PLM_StartSequence(self.handle, holograms_to_display)
+
+    def sequence_status(self):
+        """State of the sequencer as of the last vsync, safe to poll from any thread."""
+        return _sequence_status(self.lib.PLM_GetSequenceStatus, self.handle)
+
+    def resize_frame_store(self, num_frames):
+        """Change the number of frames the pipeline holds, keeping the stored frames where they fit."""
+        res = self.lib.PLM_ResizeFrameStore(self.handle, num_frames)
+        if res:
+            self.num_frames = num_frames
+        return res
+
+    def close(self):
+        """Free the pipeline. The one shown in the PLM window has to be stopped first."""
+        if self.handle is not None and self.lib.PLM_Destroy(self.handle):
+            self.handle = None